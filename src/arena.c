@@ -0,0 +1,101 @@
+//
+//  arena.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define ARENA_ALIGNMENT (16)
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+_Thread_local arena_t frame_arena = { NULL, ARENA_DEFAULT_BLOCK_SIZE };
+_Thread_local arena_t *scene_arena = NULL;
+
+
+bool arena_add_block(arena_t *arena, size_t min_capacity) {
+	// Each new block is at least twice as large as the last, so a frame that needs a lot
+	// of memory only takes a few blocks.
+	size_t capacity = arena->block_size > 0? arena->block_size : ARENA_DEFAULT_BLOCK_SIZE;
+	if (arena->block && capacity < arena->block->capacity * 2) capacity = arena->block->capacity * 2;
+	if (capacity < min_capacity) capacity = min_capacity;
+
+	arena_block_t *block = malloc(sizeof(arena_block_t) + capacity);
+	if (!block) {
+		fprintf(stderr, "Unable to allocate arena block!\n");
+		return false;
+	}
+	block->previous = arena->block;
+	block->capacity = capacity;
+	block->used = 0;
+	arena->block = block;
+	return true;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	if (!arena->block || arena->block->used + size > arena->block->capacity) {
+		if (!arena_add_block(arena, size)) return NULL;
+	}
+	void *p = arena->block->data + arena->block->used;
+	arena->block->used += size;
+	return p;
+}
+
+void arena_reset(arena_t *arena) {
+	if (!arena->block) return;
+
+	if (arena->block->previous) {
+		// The last frame overflowed into several blocks: replace them with a single block
+		// large enough for all of them, so the next frame fits in one.
+		size_t total = 0;
+		for (arena_block_t *b = arena->block; b; b = b->previous) {
+			total += b->capacity;
+		}
+		arena_free(arena);
+		if (arena->block_size < total) arena->block_size = total;
+		arena_add_block(arena, total);
+	} else {
+		arena->block->used = 0;
+	}
+}
+
+void arena_free(arena_t *arena) {
+	arena_block_t *b = arena->block;
+	while (b) {
+		arena_block_t *previous = b->previous;
+		free(b);
+		b = previous;
+	}
+	arena->block = NULL;
+}
+
+void *arena_or_heap_alloc(arena_t *arena, size_t size) {
+	return arena? arena_alloc(arena, size) : malloc(size);
+}
+
+void arena_or_heap_free(arena_t *arena, void *p) {
+	// Arena memory is only released when the whole arena is freed
+	if (!arena) free(p);
+}
+
+#pragma mark - Marks
+
+arena_mark_t arena_mark(arena_t *arena) {
+	arena_mark_t mark = { arena->block, arena->block? arena->block->used : 0 };
+	return mark;
+}
+
+void arena_restore(arena_t *arena, arena_mark_t mark) {
+	// Free blocks added since the mark
+	while (arena->block && arena->block != mark.block) {
+		arena_block_t *previous = arena->block->previous;
+		free(arena->block);
+		arena->block = previous;
+	}
+	if (arena->block) arena->block->used = mark.used;
+}
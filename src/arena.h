@@ -0,0 +1,53 @@
+//
+//  arena.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Bump allocator for short-lived buffers. Allocations are never freed
+// individually; the whole arena is reset at once.
+
+#ifndef arena_h
+#define arena_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct arena_block_s {
+	struct arena_block_s *previous;
+	size_t capacity;
+	size_t used;
+	uint8_t data[];
+} arena_block_t;
+
+typedef struct {
+	arena_block_t *block; // current block, NULL until first allocation
+	size_t block_size; // minimum size of new blocks
+} arena_t;
+
+// Position to roll back to with arena_restore()
+typedef struct {
+	arena_block_t *block;
+	size_t used;
+} arena_mark_t;
+
+// Transient buffers for the current frame, reset at the start of every frame
+extern _Thread_local arena_t frame_arena;
+
+// While set, new meshes and shapes and everything they allocate come from this arena,
+// so a whole scene is freed at once with arena_free(). NULL uses the heap.
+extern _Thread_local arena_t *scene_arena;
+
+void *arena_alloc(arena_t *arena, size_t size);
+void arena_reset(arena_t *arena);
+void arena_free(arena_t *arena);
+
+// Allocate from an arena, or from the heap if arena is NULL
+void *arena_or_heap_alloc(arena_t *arena, size_t size);
+void arena_or_heap_free(arena_t *arena, void *p);
+
+arena_mark_t arena_mark(arena_t *arena);
+void arena_restore(arena_t *arena, arena_mark_t mark);
+
+#endif /* arena_h */
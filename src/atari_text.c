@@ -12,7 +12,7 @@
 // Globals
 uint8_t *atari_font = NULL;
 size_t atari_font_len = 0;
-uint32_t key_text_color = COLOR_ABGR_BLACK;
+_Thread_local uint32_t key_text_color = COLOR_ABGR_BLACK;
 
 
 bool atari_text_init(void) {
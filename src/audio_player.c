@@ -25,10 +25,15 @@
 // Globals
 //SDL_AudioSpec audio_spec;
 Mix_Music *song = NULL;
-bool music_paused = false;
+_Thread_local bool music_paused = false;
 int music_volume = MAX_MUSIC_VOLUME;
 bool music_muted = false;
 
+// Offline rendering: nothing is played, and the song position only moves with advance_offline_music()
+bool music_offline = false;
+_Thread_local bool offline_music_playing = false;
+_Thread_local double offline_music_position = 0.0;
+
 // Functions
 
 bool init_audio(void) {
@@ -57,29 +62,53 @@ bool init_audio(void) {
 	return true;
 }
 
+bool init_offline_audio(void) {
+	music_offline = true;
+	return true;
+}
+
+void advance_offline_music(double delta_time) {
+	if (!offline_music_playing || music_paused) return;
+	offline_music_position += delta_time;
+	if (offline_music_position >= SONG_DURATION) {
+		offline_music_position = SONG_DURATION;
+		offline_music_playing = false;
+	}
+}
+
 void start_music(void) {
 	// fprintf(stdout, "Start audio playback.\n");
-	Mix_PlayMusic(song, 0);
+	if (music_offline) {
+		offline_music_playing = true;
+		offline_music_position = 0.0;
+	} else {
+		Mix_PlayMusic(song, 0);
+	}
 	music_paused = false;
 }
 
 void pause_music(bool state) {
 	// fprintf(stdout, "Pause audio playback.\n");
 	if (state) {
-		Mix_PauseMusic();
+		if (!music_offline) Mix_PauseMusic();
 		music_paused = true;
 	} else {
-		Mix_ResumeMusic();
+		if (!music_offline) Mix_ResumeMusic();
 		music_paused = false;
 	}
 }
 
 void stop_music(void) {
 	// fprintf(stdout, "Stop audio playback.\n");
-	Mix_HaltMusic();
+	if (music_offline) {
+		offline_music_playing = false;
+	} else {
+		Mix_HaltMusic();
+	}
 }
 
 bool is_music_playing(void) {
+	if (music_offline) return offline_music_playing;
 	return Mix_PlayingMusic() != 0;
 }
 
@@ -100,7 +129,7 @@ void set_music_volume(int vol) {
 	music_muted = false;
 	float db = (vol - MAX_MUSIC_VOLUME) * 3.0f;
 	float scalar = powf(10.0f, db/10.0f);
-	Mix_VolumeMusic((int)roundf(scalar * 128.0f));
+	if (!music_offline) Mix_VolumeMusic((int)roundf(scalar * 128.0f));
 	
 	//fprintf(stdout, "Volume: %1.0f dB, %1.4f\n", db, scalar);
 }
@@ -112,17 +141,19 @@ bool is_music_muted(void) {
 void set_music_muted(bool state) {
 	music_muted = state;
 	if (music_muted) {
-		Mix_VolumeMusic(0);
+		if (!music_offline) Mix_VolumeMusic(0);
 	} else {
 		set_music_volume(music_volume);
 	}
 }
 
 double get_music_duration(void) {
+	if (music_offline) return SONG_DURATION;
 	return Mix_MusicDuration(song);
 }
 
 double get_music_position(void) {
+	if (music_offline) return offline_music_position;
 	return Mix_GetMusicPosition(song);
 }
 
@@ -130,5 +161,9 @@ void set_music_position(double x) {
 	if (x < 0.0) x = 0.0;
 	double max = get_music_duration();
 	if (x > max) x = max;
-	Mix_SetMusicPosition(x);
+	if (music_offline) {
+		offline_music_position = x;
+	} else {
+		Mix_SetMusicPosition(x);
+	}
 }
@@ -13,6 +13,8 @@
 #define SONG_DURATION (92.2371)
 
 bool init_audio(void);
+bool init_offline_audio(void); // instead of init_audio(), for rendering without playing the song
+void advance_offline_music(double delta_time);
 void start_music(void);
 void pause_music(bool state);
 void stop_music(void);
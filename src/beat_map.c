@@ -0,0 +1,108 @@
+//
+//  beat_map.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "beat_map.h"
+
+#include <math.h>
+#include <stdio.h>
+
+
+#define BEAT_MAP_MAX_BUCKETS (4096)
+
+
+#pragma mark - Segments
+
+bool beat_segments_set_times(beat_segment_t *segments, int count, double offset) {
+	if (count < 1 || segments[0].beat != 0.0) return false;
+	segments[0].time = offset;
+	for (int i = 0; i < count; i++) {
+		if (!(segments[i].bpm > 0.0)) return false;
+		if (i == 0) continue;
+		const beat_segment_t *previous = &segments[i - 1];
+		if (!(segments[i].beat > previous->beat)) return false;
+		segments[i].time = previous->time + (segments[i].beat - previous->beat) * 60.0 / previous->bpm;
+	}
+	return true;
+}
+
+int beat_segments_find_beat(const beat_segment_t *segments, int count, double beat) {
+	// Last segment starting at or before the beat, or the first segment
+	int low = 0;
+	int high = count - 1;
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (segments[mid].beat <= beat) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+double beat_segments_time_at(const beat_segment_t *segments, int count, double beat) {
+	const beat_segment_t *s = &segments[beat_segments_find_beat(segments, count, beat)];
+	return s->time + (beat - s->beat) * 60.0 / s->bpm;
+}
+
+
+#pragma mark - Map
+
+bool beat_map_init(beat_map_t *map, const beat_segment_t *segments, int count, int beats_per_bar, arena_t *arena) {
+	*map = (beat_map_t){ segments, count, beats_per_bar, NULL, 0, 0.0 };
+	if (count < 1) return false;
+	if (count == 1) return true;
+
+	// Buckets no longer than the shortest segment hold at most one change of tempo
+	double shortest = INFINITY;
+	for (int i = 1; i < count; i++) {
+		shortest = fmin(shortest, segments[i].time - segments[i - 1].time);
+	}
+	const double span = segments[count - 1].time - segments[0].time;
+	map->bucket_time = fmax(shortest, span / (BEAT_MAP_MAX_BUCKETS - 1));
+	map->bucket_count = (int)(span / map->bucket_time) + 1;
+	map->buckets = arena_alloc(arena, sizeof(int) * (size_t)map->bucket_count);
+	if (!map->buckets) {
+		fprintf(stderr, "Unable to allocate beat map!\n");
+		return false;
+	}
+	int s = 0;
+	for (int i = 0; i < map->bucket_count; i++) {
+		const double time = segments[0].time + i * map->bucket_time;
+		while (s + 1 < count && time >= segments[s + 1].time) {
+			s++;
+		}
+		map->buckets[i] = s;
+	}
+	return true;
+}
+
+int beat_map_find_time(const beat_map_t *map, double time) {
+	if (map->segment_count < 2) return 0;
+	const beat_segment_t *segments = map->segments;
+	int i = (int)((time - segments[0].time) / map->bucket_time);
+	i = i < 0? 0 : (i >= map->bucket_count? map->bucket_count - 1 : i);
+
+	// Rounding may put the time just outside its bucket's segment
+	int s = map->buckets[i];
+	while (s + 1 < map->segment_count && time >= segments[s + 1].time) {
+		s++;
+	}
+	while (s > 0 && time < segments[s].time) {
+		s--;
+	}
+	return s;
+}
+
+double beat_map_beat_at(const beat_map_t *map, double time) {
+	const beat_segment_t *s = &map->segments[beat_map_find_time(map, time)];
+	return s->beat + (time - s->time) * s->bpm / 60.0;
+}
+
+double beat_map_time_at(const beat_map_t *map, double beat) {
+	return beat_segments_time_at(map->segments, map->segment_count, beat);
+}
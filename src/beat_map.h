@@ -0,0 +1,43 @@
+//
+//  beat_map.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Tempo map of a song, as segments of constant tempo. Beats are counted from
+// 0 at the start of the first segment. Finding the beat at a time looks in a
+// table of evenly spaced times, and checks at most two segments.
+
+#ifndef beat_map_h
+#define beat_map_h
+
+#include "arena.h"
+
+#include <stdbool.h>
+
+typedef struct {
+	double beat; // first beat of the segment
+	double time; // seconds at that beat
+	double bpm;
+} beat_segment_t;
+
+typedef struct {
+	const beat_segment_t *segments;
+	int segment_count;
+	int beats_per_bar;
+	int *buckets; // segment at the start of each bucket
+	int bucket_count;
+	double bucket_time; // seconds per bucket, no longer than the shortest segment
+} beat_map_t;
+
+// Sets the time of each segment from the time of beat 0 and the tempos before it.
+// Segments must start at beat 0 and go up in beats, with tempos above 0.
+bool beat_segments_set_times(beat_segment_t *segments, int count, double offset);
+double beat_segments_time_at(const beat_segment_t *segments, int count, double beat);
+
+// The index table comes from the arena
+bool beat_map_init(beat_map_t *map, const beat_segment_t *segments, int count, int beats_per_bar, arena_t *arena);
+double beat_map_beat_at(const beat_map_t *map, double time);
+double beat_map_time_at(const beat_map_t *map, double beat);
+
+#endif /* beat_map_h */
@@ -45,6 +45,19 @@ uint32_t blend_color(uint32_t x, uint32_t y) {
     return color_from_rgba_int((uint8_t)zr, (uint8_t)zg, (uint8_t)zb, 255);
 }
 
+uint32_t color_interpolate(uint32_t x, uint32_t y, uint32_t w) {
+	// Blends all four channels from x to y by w out of 255, rounding like blend_color().
+	// Two channels at a time, each in its own 16 bit lane.
+	uint32_t xw = 255 - w;
+	uint32_t rb = (x & 0x00FF00FF) * xw + (y & 0x00FF00FF) * w;
+	uint32_t ag = ((x >> 8) & 0x00FF00FF) * xw + ((y >> 8) & 0x00FF00FF) * w;
+	
+	// n / 255 is (n + 1 + n / 256) / 256 for n up to 255 * 255
+	rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	ag = ((ag + 0x00010001 + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	return rb | (ag << 8);
+}
+
 uint32_t color_from_hsv(double h, double s, double v, double a) {
     // Adapted from: https://stackoverflow.com/questions/3018313/algorithm-to-convert-rgb-to-hsv-and-hsv-to-rgb-in-range-0-255-for-both
     
@@ -72,6 +72,7 @@
 
 
 uint32_t blend_color(uint32_t x, uint32_t y);
+uint32_t color_interpolate(uint32_t x, uint32_t y, uint32_t w);
 
 uint32_t color_from_hsv(double h, double s, double v, double a);
 
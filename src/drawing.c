@@ -17,19 +17,10 @@
 SDL_Window* sdl_window;
 SDL_Renderer* sdl_renderer;
 SDL_Texture* sdl_texture;
-uint32_t* screen_pixels;
-int screen_w;
-int screen_h;
-size_t screen_pitch;
 
-// Drawing context
-uint32_t line_color;
-uint32_t fill_color;
-vec2_t cursor;
-
-// Transforms
-mat3_t view_transform_2d;
-mat4_t camera_transform_3d;
+// Drawing context: the window's frame buffer, unless the thread has set its own
+draw_context_t draw_main_context;
+_Thread_local draw_context_t *draw_context = &draw_main_context;
 
 #pragma mark - Rectangle
 
@@ -64,13 +55,48 @@ rectangle_t intersect_rect(rectangle_t a, rectangle_t b) {
 
 void init_projection(void) {
 	// Set default view transform to center on and scale to screen
-	view_transform_2d = mat3_translate(mat3_identity(), vec2_make(screen_w / 2, screen_h / 2));
-	float scale2d = screen_h;
-	view_transform_2d = mat3_scale(view_transform_2d, vec2_make(scale2d, -scale2d));
+	float scale2d = draw_context->height;
+	draw_context->view_transform_2d = affine2_make(vec2_make(draw_context->width / 2, draw_context->height / 2), 0, vec2_make(scale2d, -scale2d));
 	
 	// Set default camera transform to z + 5 units.
 	// Positive Z corresponds to further into the picture plane.
-	camera_transform_3d = mat4_translate(mat4_identity(), vec3_make(0, 0, 5));
+	draw_context->camera_transform_3d = affine3_make(vec3_make(0, 0, 5), vec3_zero(), vec3_identity());
+}
+
+bool draw_context_init(draw_context_t *context, int width, int height) {
+	// Store dimensions in the context
+	context->width = width;
+	context->height = height;
+	context->pitch = (size_t)width * sizeof(uint32_t);
+	
+	// Allocate frame buffer
+	context->pixels = (uint32_t*)malloc((size_t)(height) * context->pitch);
+	if (!context->pixels) {
+		fprintf(stderr, "malloc() failed!\n");
+		return false;
+	}
+	
+	// Clear it and set up default transforms
+	draw_context_t *previous = draw_context;
+	draw_context = context;
+	set_fill_color_abgr(COLOR_ABGR_BLACK);
+	fill_screen();
+	init_projection();
+	draw_context = previous;
+	return true;
+}
+
+void draw_context_free(draw_context_t *context) {
+	free(context->pixels);
+	context->pixels = NULL;
+}
+
+void set_draw_context(draw_context_t *context) {
+	draw_context = context? context : &draw_main_context;
+}
+
+bool init_frame_buffer(int width, int height) {
+	return draw_context_init(&draw_main_context, width, height);
 }
 
 bool init_screen(int width, int height, int scale) {
@@ -82,10 +108,6 @@ bool init_screen(int width, int height, int scale) {
 		return false;
 	}
 	
-	// Store dimensions in globals
-	screen_w = width;
-	screen_h = height;
-	screen_pitch = (size_t)width * sizeof(uint32_t);
 	SDL_Rect window_rect;
 	window_rect.x = window_rect.y = 0;
 	window_rect.w = width * scale;
@@ -105,13 +127,7 @@ bool init_screen(int width, int height, int scale) {
 	}
 
 	// Allocate frame buffer
-	screen_pixels = (uint32_t*)malloc((size_t)(height) * screen_pitch);
-	if (!screen_pixels) {
-		fprintf(stderr, "malloc() failed!\n");
-		return false;
-	}
-	set_fill_color_abgr(COLOR_ABGR_BLACK);
-	fill_screen();
+	if (!init_frame_buffer(width, height)) return false;
 	
 	// Set up the renderer
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, 0); // Use no interpolation
@@ -121,16 +137,13 @@ bool init_screen(int width, int height, int scale) {
 	SDL_RenderPresent(sdl_renderer);
 
 	// Debug logging: window * texture size
-	fprintf(stdout, "Created window (%dx%d) and texture (%dx%d).\n", window_rect.w, window_rect.h, screen_w, screen_h);
-	
-	// Set up default transforms
-	init_projection();
+	fprintf(stdout, "Created window (%dx%d) and texture (%dx%d).\n", window_rect.w, window_rect.h, draw_context->width, draw_context->height);
 
 	return true;
 }
 
 void destroy_screen(void) {
-	free(screen_pixels);
+	draw_context_free(&draw_main_context);
 	SDL_DestroyTexture(sdl_texture);
 	SDL_DestroyRenderer(sdl_renderer);
 	SDL_DestroyWindow(sdl_window);
@@ -142,16 +155,16 @@ void render_to_screen(void) {
 	int window_w, window_h;
 	SDL_GetWindowSize(sdl_window, &window_w, &window_h);
 	
-	int scale_w = window_w / screen_w;
-	int scale_h = window_h / screen_h;
+	int scale_w = window_w / draw_context->width;
+	int scale_h = window_h / draw_context->height;
 	int scale = scale_w < scale_h? scale_w : scale_h;
 	SDL_Rect r;
-	r.w = screen_w * scale;
-	r.h = screen_h * scale;
+	r.w = draw_context->width * scale;
+	r.h = draw_context->height * scale;
 	r.x = (window_w - r.w) / 2;
 	r.y = (window_h - r.h) / 2;
 	
-	SDL_UpdateTexture(sdl_texture, NULL, screen_pixels, (int)screen_pitch);
+	SDL_UpdateTexture(sdl_texture, NULL, draw_context->pixels, (int)draw_context->pitch);
 	SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, &r);
 	SDL_RenderPresent(sdl_renderer);
 }
@@ -159,45 +172,45 @@ void render_to_screen(void) {
 #pragma mark - Drawing 2D
 
 void fill_screen(void) {
-	for (int i = 0; i < screen_w * screen_h; i++) {
-		screen_pixels[i] = fill_color;
+	for (int i = 0; i < draw_context->width * draw_context->height; i++) {
+		draw_context->pixels[i] = draw_context->fill_color;
 	}
 }
 
 void set_line_color_abgr(uint32_t color) {
-	line_color = color;
+	draw_context->line_color = color;
 }
 
 void set_line_color_rgba(uint32_t color, uint8_t alpha) {
-	line_color = rgba_to_abgr(color, alpha);
+	draw_context->line_color = rgba_to_abgr(color, alpha);
 }
 
 void set_fill_color_abgr(uint32_t color) {
-	fill_color = color;
+	draw_context->fill_color = color;
 }
 
 void set_fill_color_rgba(uint32_t color, uint8_t alpha) {
-	fill_color = rgba_to_abgr(color, alpha);
+	draw_context->fill_color = rgba_to_abgr(color, alpha);
 }
 
 void move_to(vec2_t a) {
-	cursor = a;
+	draw_context->cursor = a;
 }
 
 void line_to(vec2_t a) {
-	float dx = a.x - cursor.x;
-	float dy = a.y - cursor.y;
+	float dx = a.x - draw_context->cursor.x;
+	float dy = a.y - draw_context->cursor.y;
 	float steps = fabsf(dx) > fabsf(dy)? fabsf(dx) : fabsf(dy);
 	float sx = dx / steps;
 	float sy = dy / steps;
-	float x = cursor.x;
-	float y = cursor.y;
+	float x = draw_context->cursor.x;
+	float y = draw_context->cursor.y;
 	for (float i = 0.0f; i <= steps; i++) {
-		set_pixel((int)floorf(x), (int)floorf(y), line_color);
+		set_pixel((int)floorf(x), (int)floorf(y), draw_context->line_color);
 		x += sx;
 		y += sy;
 	}
-	cursor = a;
+	draw_context->cursor = a;
 }
 
 void stroke_rect(rectangle_t r) {
@@ -221,7 +234,7 @@ void fill_rect(rectangle_t r) {
 	
 	for (int y = y0; y < y1; y++) {
 		for (int x = x0; x < x1; x++) {
-			set_pixel(x, y, fill_color);
+			set_pixel(x, y, draw_context->fill_color);
 		}
 	}
 }
@@ -232,17 +245,74 @@ void fill_centered_rect(int x, int y, int w, int h) {
 }
 
 void set_pixel(int x, int y, uint32_t color) {
-	if (x < 0 || x >= screen_w) return;
-	if (y < 0 || y >= screen_h) return;
+	if (x < 0 || x >= draw_context->width) return;
+	if (y < 0 || y >= draw_context->height) return;
 	
 	// Apply blending if color's alpha < 255
-	int i = x + y * screen_w;
+	int i = x + y * draw_context->width;
 	if ((color & 0xFF000000) != 0xFF000000) {
-		color = blend_color(screen_pixels[i], color);
+		color = blend_color(draw_context->pixels[i], color);
 	}
-	screen_pixels[i] = color;
+	draw_context->pixels[i] = color;
 }
 
+#pragma mark - Point Sprites
+
+typedef struct {
+	int size;
+	uint8_t mask[5][5];
+} point_sprite_t;
+
+const point_sprite_t square_point_sprite = {
+	3, {
+		{ 1, 1, 1 },
+		{ 1, 1, 1 },
+		{ 1, 1, 1 }
+	}
+};
+
+const point_sprite_t round_point_sprite = {
+	5, {
+		{ 0, 1, 1, 1, 0 },
+		{ 1, 1, 1, 1, 1 },
+		{ 1, 1, 1, 1, 1 },
+		{ 1, 1, 1, 1, 1 },
+		{ 0, 1, 1, 1, 0 }
+	}
+};
+
+void fill_point_sprite(int x, int y, const point_sprite_t *sprite) {
+	// Clip the sprite to the screen once, instead of per pixel
+	int x0 = x - sprite->size / 2;
+	int y0 = y - sprite->size / 2;
+	int i0 = x0 < 0? -x0 : 0;
+	int j0 = y0 < 0? -y0 : 0;
+	int i1 = x0 + sprite->size > draw_context->width? draw_context->width - x0 : sprite->size;
+	int j1 = y0 + sprite->size > draw_context->height? draw_context->height - y0 : sprite->size;
+	
+	const uint32_t color = draw_context->fill_color;
+	const bool opaque = (color & 0xFF000000) == 0xFF000000;
+	for (int j = j0; j < j1; j++) {
+		// Start the row at the first visible pixel, so the pointer never points outside the buffer
+		uint32_t *row = &draw_context->pixels[(y0 + j) * draw_context->width + x0 + i0];
+		for (int i = i0; i < i1; i++) {
+			if (sprite->mask[j][i]) {
+				row[i - i0] = opaque? color : blend_color(row[i - i0], color);
+			}
+		}
+	}
+}
+
+void fill_point(int x, int y) {
+	fill_point_sprite(x, y, &square_point_sprite);
+}
+
+void fill_round_point(int x, int y) {
+	fill_point_sprite(x, y, &round_point_sprite);
+}
+
+#pragma mark -
+
 void swap_vec2(vec2_t *x, vec2_t *y) {
 	vec2_t tmp = *x;
 	*y = *x;
@@ -280,7 +350,7 @@ void fill_triangle(vec2_t a, vec2_t b, vec2_t c) {
 		for (float x = floorf(x0); x <= ceilf(x1); x++) {
 			vec2_t p = { x + 0.5f, y + 0.5f };
 			if (point_in_triangle(p, a, b, c)) {
-				set_pixel((int)x, (int)y, fill_color);
+				set_pixel((int)x, (int)y, draw_context->fill_color);
 			}
 		}
 	}
@@ -349,7 +419,7 @@ void fill_polygon(vec2_t *points, int n) {
 	// https://stackoverflow.com/questions/65573101/draw-a-filled-polygon-using-scanline-loop
 	if (n < 3) return;
 	rectangle_t bounds = bounding_rect(points, n);
-	rectangle_t screen = { .x = 0, .y = 0, .w = screen_w, .h = screen_h };
+	rectangle_t screen = { .x = 0, .y = 0, .w = draw_context->width, .h = draw_context->height };
 	rectangle_t draw = intersect_rect(bounds, screen);
 	for (float y = floorf(draw.y); y <= ceilf(draw.y + draw.h); y++) {
 		int crossings = 0;
@@ -361,7 +431,7 @@ void fill_polygon(vec2_t *points, int n) {
 			float right = x + 0.5f;
 			crossings += edge_crossings(left, right, y + 0.5f, points, n);
 			if (crossings % 2 == 1) {
-				set_pixel((int)x, (int)y, fill_color);
+				set_pixel((int)x, (int)y, draw_context->fill_color);
 			}
 		}
 	}
@@ -369,11 +439,12 @@ void fill_polygon(vec2_t *points, int n) {
 
 #pragma mark - Getters
 
-vec2_t get_cursor(void) { return cursor; }
-uint32_t get_line_color(void) { return line_color; }
-uint32_t get_fill_color(void) { return fill_color; }
-int get_screen_width(void) { return screen_w; }
-int get_screen_height(void) { return screen_h; }
+vec2_t get_cursor(void) { return draw_context->cursor; }
+uint32_t get_line_color(void) { return draw_context->line_color; }
+uint32_t get_fill_color(void) { return draw_context->fill_color; }
+int get_screen_width(void) { return draw_context->width; }
+int get_screen_height(void) { return draw_context->height; }
+const uint32_t *get_screen_pixels(void) { return draw_context->pixels; }
 
 #pragma mark - Projection 3D
 
@@ -382,24 +453,28 @@ vec2_t orthographic_project_point(vec3_t pt3d) {
 	vec2_t pt2d = { .x = pt3d.x, .y = pt3d.y };
 
 	// Apply view transform
-	pt2d = vec2_mat3_multiply(pt2d, view_transform_2d);
+	pt2d = vec2_affine2_multiply(pt2d, draw_context->view_transform_2d);
 	return pt2d;
 }
 
 vec2_t perspective_project_point(vec3_t pt3d) {
 	// Apply 3d transforms
-	pt3d = vec3_mat4_multiply(pt3d, camera_transform_3d);
+	pt3d = vec3_affine3_multiply(pt3d, draw_context->camera_transform_3d);
+	return perspective_project_camera_point(pt3d);
+}
 
+vec2_t perspective_project_camera_point(vec3_t pt3d) {
+	// Point is already in camera space
 	vec2_t pt2d = { .x = pt3d.x / pt3d.z, .y = pt3d.y / pt3d.z };
 
 	// Apply view transform
-	pt2d = vec2_mat3_multiply(pt2d, view_transform_2d);
+	pt2d = vec2_affine2_multiply(pt2d, draw_context->view_transform_2d);
 
 	return pt2d;
 }
 
 vec3_t get_camera_position(void) {
 	vec3_t a = { 0, 0, 0 };
-	vec3_t b = vec3_mat4_multiply(a, camera_transform_3d);
+	vec3_t b = vec3_affine3_multiply(a, draw_context->camera_transform_3d);
 	return vec3_sub(a, b);
 }
@@ -25,17 +25,33 @@ typedef struct {
 rectangle_t inset_rect(rectangle_t r, int x, int y);
 rectangle_t intersect_rect(rectangle_t a, rectangle_t b);
 
+// Drawing context: a frame buffer with the drawing state and transforms.
+// Each thread draws into its own current context.
+typedef struct {
+	uint32_t *pixels;
+	int width;
+	int height;
+	size_t pitch;
+	uint32_t line_color;
+	uint32_t fill_color;
+	vec2_t cursor;
+	affine2_t view_transform_2d;
+	affine3_t camera_transform_3d;
+} draw_context_t;
+
+extern _Thread_local draw_context_t *draw_context;
+
+bool draw_context_init(draw_context_t *context, int width, int height);
+void draw_context_free(draw_context_t *context);
+void set_draw_context(draw_context_t *context); // NULL for the window's context
+
 // SDL Interface
+bool init_frame_buffer(int width, int height); // without a window, for offline rendering
 bool init_screen(int width, int height, int scale);
 void destroy_screen(void);
 void render_to_screen(void);
 
 
-// Transform 2D
-extern mat3_t view_transform_2d;
-extern mat4_t camera_transform_3d;
-
-
 // Drawing 2D
 void fill_screen(void);
 
@@ -55,15 +71,21 @@ void fill_polygon(vec2_t *points, int n);
 
 void set_pixel(int x, int y, uint32_t color);
 
+// Point sprites, drawn with the fill color
+void fill_point(int x, int y); // 3x3 square
+void fill_round_point(int x, int y); // 5x5 circle
+
 vec2_t get_cursor(void);
 uint32_t get_line_color(void);
 uint32_t get_fill_color(void);
 int get_screen_width(void);
 int get_screen_height(void);
+const uint32_t *get_screen_pixels(void); // ABGR
 
 // Projection 3D
 vec2_t orthographic_project_point(vec3_t pt3d);
 vec2_t perspective_project_point(vec3_t pt3d);
+vec2_t perspective_project_camera_point(vec3_t pt3d);
 vec3_t get_camera_position(void);
 
 #endif /* drawing_h */
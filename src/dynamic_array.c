@@ -0,0 +1,60 @@
+//
+//  dynamic_array.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "dynamic_array.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+bool dynamic_array_reserve(void **array, int *capacity, int length, int min_capacity, size_t element_size, arena_t *arena, void *inline_storage) {
+	if (min_capacity <= *capacity) return true;
+	
+	// Grow geometrically so that adding one element at a time is amortized O(1)
+	int new_capacity = *capacity > 0? *capacity * 2 : 4;
+	if (new_capacity < min_capacity) new_capacity = min_capacity;
+	const size_t size = element_size * (size_t)new_capacity;
+	
+	void *new_array;
+	if (arena || *array == inline_storage) {
+		// Arena memory and inline storage can't be resized in place, so copy
+		new_array = arena_or_heap_alloc(arena, size);
+		if (new_array && length > 0) memcpy(new_array, *array, element_size * (size_t)length);
+	} else {
+		new_array = realloc(*array, size);
+	}
+	if (!new_array) {
+		fprintf(stderr, "Unable to allocate dynamic array!\n");
+		return false;
+	}
+	
+	*array = new_array;
+	*capacity = new_capacity;
+	return true;
+}
+
+void dynamic_array_shrink_to_fit(void **array, int *capacity, int length, size_t element_size, arena_t *arena, void *inline_storage, int inline_capacity) {
+	// Arena memory is only released when the whole arena is freed
+	if (arena || *array == inline_storage || length >= *capacity) return;
+	
+	if (length <= inline_capacity) {
+		// Move back into the inline storage
+		memcpy(inline_storage, *array, element_size * (size_t)length);
+		free(*array);
+		*array = inline_storage;
+		*capacity = inline_capacity;
+	} else {
+		void *new_array = realloc(*array, element_size * (size_t)length);
+		if (!new_array) return;
+		*array = new_array;
+		*capacity = length;
+	}
+}
+
+void dynamic_array_free(void *array, arena_t *arena, void *inline_storage) {
+	if (array != inline_storage) arena_or_heap_free(arena, array);
+}
@@ -0,0 +1,80 @@
+//
+//  dynamic_array.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Typed growable arrays. DYNAMIC_ARRAY(name, type, inline_capacity) declares
+// name_t and its functions. The first inline_capacity elements are stored
+// inside the struct itself, so short arrays need no allocation at all. Larger
+// arrays grow into the arena given to name_init(), or the heap if it is NULL.
+//
+// Because the inline elements are part of the struct, an array must not be
+// copied or moved to another address once it has been initialized.
+
+#ifndef dynamic_array_h
+#define dynamic_array_h
+
+#include "arena.h"
+#include <stdbool.h>
+#include <string.h>
+
+// Untyped implementation shared by all array types
+bool dynamic_array_reserve(void **array, int *capacity, int length, int min_capacity, size_t element_size, arena_t *arena, void *inline_storage);
+void dynamic_array_shrink_to_fit(void **array, int *capacity, int length, size_t element_size, arena_t *arena, void *inline_storage, int inline_capacity);
+void dynamic_array_free(void *array, arena_t *arena, void *inline_storage);
+
+#define DYNAMIC_ARRAY(name, type, inline_capacity) \
+typedef struct { \
+	type *array; \
+	int length; \
+	int capacity; \
+	arena_t *arena; /* NULL for heap */ \
+	type inline_storage[inline_capacity]; \
+} name##_t; \
+\
+static inline void name##_init(name##_t *a, arena_t *arena) { \
+	a->array = a->inline_storage; \
+	a->length = 0; \
+	a->capacity = (inline_capacity); \
+	a->arena = arena; \
+} \
+\
+static inline void name##_free(name##_t *a) { \
+	dynamic_array_free(a->array, a->arena, a->inline_storage); \
+	name##_init(a, a->arena); \
+} \
+\
+static inline bool name##_reserve(name##_t *a, int capacity) { \
+	if (capacity <= a->capacity) return true; \
+	return dynamic_array_reserve((void **)&a->array, &a->capacity, a->length, capacity, sizeof(type), a->arena, a->inline_storage); \
+} \
+\
+static inline void name##_shrink_to_fit(name##_t *a) { \
+	dynamic_array_shrink_to_fit((void **)&a->array, &a->capacity, a->length, sizeof(type), a->arena, a->inline_storage, (inline_capacity)); \
+} \
+\
+static inline bool name##_add(name##_t *a, type element) { \
+	if (!name##_reserve(a, a->length + 1)) return false; \
+	a->array[a->length++] = element; \
+	return true; \
+} \
+\
+static inline bool name##_append(name##_t *a, const type *elements, int n) { \
+	if (n <= 0) return true; \
+	if (!name##_reserve(a, a->length + n)) return false; \
+	memcpy(a->array + a->length, elements, sizeof(type) * (size_t)n); \
+	a->length += n; \
+	return true; \
+} \
+\
+/* Replaces the element at index with the last element, so order is not kept */ \
+static inline void name##_remove_at(name##_t *a, int index) { \
+	a->array[index] = a->array[--a->length]; \
+} \
+\
+static inline void name##_remove_all(name##_t *a) { \
+	a->length = 0; \
+}
+
+#endif /* dynamic_array_h */
@@ -0,0 +1,246 @@
+//
+//  easing.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "easing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define EASING_TABLE_SIZE (1024) // segments in the tables of built in curves
+#define EASING_INVERSE_SIZE (256) // segments in the bezier parameter tables
+#define EASING_BATCH_SIZE (256) // values grouped by curve at a time
+#define EASING_CURVE_LIMIT (EaseCustom + EASING_MAX_CURVES)
+
+// Globals
+float easing_bounce_table[EASING_TABLE_SIZE + 1];
+float easing_elastic_table[EASING_TABLE_SIZE + 1];
+_Thread_local easing_bezier_t easing_curves[EASING_MAX_CURVES];
+_Thread_local float easing_inverse_tables[EASING_MAX_CURVES][EASING_INVERSE_SIZE + 1];
+_Thread_local int easing_curve_count = 0;
+
+
+#pragma mark - Curves
+
+float easing_out_bounce(float x) {
+	// https://easings.net/
+	const float n1 = 7.5625f;
+	const float d1 = 2.75f;
+	if (x < 1.0f / d1) {
+		return n1 * x * x;
+	} else if (x < 2.0f / d1) {
+		x -= 1.5f / d1;
+		return n1 * x * x + 0.75f;
+	} else if (x < 2.5f / d1) {
+		x -= 2.25f / d1;
+		return n1 * x * x + 0.9375f;
+	} else {
+		x -= 2.625f / d1;
+		return n1 * x * x + 0.984375f;
+	}
+}
+
+float easing_out_elastic(float x) {
+	const float c4 = 2 * (float)M_PI / 3;
+	const float v = 6.0f;
+	if (x <= 0.0f) return 0.0f;
+	if (x >= 1.0f) return 1.0f;
+	return powf(2, -v * x) * sinf((x * v - 0.75f) * c4) + 1;
+}
+
+float easing_bezier_coordinate(float a, float b, float t) {
+	// One coordinate of the curve, with the end points at 0 and 1
+	float s = 1.0f - t;
+	return 3.0f * s * s * t * a + 3.0f * s * t * t * b + t * t * t;
+}
+
+float easing_table_lookup(const float *table, int size, float x) {
+	float f = x * (float)size;
+	int i = (int)f;
+	if (i >= size) i = size - 1;
+	f -= (float)i;
+	return table[i] + (table[i + 1] - table[i]) * f;
+}
+
+void easing_init(void) {
+	for (int i = 0; i <= EASING_TABLE_SIZE; i++) {
+		float x = (float)i / EASING_TABLE_SIZE;
+		easing_bounce_table[i] = easing_out_bounce(x);
+		easing_elastic_table[i] = easing_out_elastic(x);
+	}
+	// Exact end points
+	easing_bounce_table[0] = 0.0f;
+	easing_bounce_table[EASING_TABLE_SIZE] = 1.0f;
+}
+
+
+#pragma mark - Bezier
+
+bool easing_bezier_is_valid(const easing_bezier_t *curve) {
+	// x must only increase along the curve
+	return curve->x1 >= 0.0f && curve->x1 <= 1.0f && curve->x2 >= 0.0f && curve->x2 <= 1.0f;
+}
+
+void easing_bezier_build_inverse(const easing_bezier_t *curve, float *table) {
+	// Find the bezier parameter t for evenly spaced x, by bisection
+	for (int i = 0; i <= EASING_INVERSE_SIZE; i++) {
+		float x = (float)i / EASING_INVERSE_SIZE;
+		float low = 0.0f, high = 1.0f;
+		for (int j = 0; j < 24; j++) {
+			float mid = 0.5f * (low + high);
+			if (easing_bezier_coordinate(curve->x1, curve->x2, mid) < x) low = mid; else high = mid;
+		}
+		table[i] = 0.5f * (low + high);
+	}
+	table[0] = 0.0f;
+	table[EASING_INVERSE_SIZE] = 1.0f;
+}
+
+bool easing_set_curves(const easing_bezier_t *curves, int count) {
+	if (count > EASING_MAX_CURVES) {
+		fprintf(stderr, "Too many easing curves!\n");
+		return false;
+	}
+	for (int i = 0; i < count; i++) {
+		if (!easing_bezier_is_valid(&curves[i])) {
+			fprintf(stderr, "Invalid easing curve!\n");
+			return false;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		easing_curves[i] = curves[i];
+		easing_bezier_build_inverse(&curves[i], easing_inverse_tables[i]);
+	}
+	easing_curve_count = count;
+	return true;
+}
+
+
+#pragma mark - Evaluation
+
+float easing_apply(easing_curve ease, float x) {
+	x = x < 0.0f? 0.0f : (x > 1.0f? 1.0f : x);
+	switch (ease) {
+		case EaseLinear:
+			return x;
+		case EaseInQuad:
+			return x * x;
+		case EaseOutQuad:
+			x = (1.0f - x);
+			return 1.0f - x * x;
+		case EaseInCubic:
+			return x * x * x;
+		case EaseOutCubic:
+			x = (1.0f - x);
+			return 1.0f - x * x * x;
+		case EaseOutBounce:
+			return easing_table_lookup(easing_bounce_table, EASING_TABLE_SIZE, x);
+		case EaseOutElastic:
+			return easing_table_lookup(easing_elastic_table, EASING_TABLE_SIZE, x);
+		case EaseBezier:
+			// Smoothstep
+			return x * x * (3.0f - 2.0f * x);
+		default:
+			break;
+	}
+
+	int i = (int)ease - EaseCustom;
+	if (i < 0 || i >= easing_curve_count) return x;
+	float t = easing_table_lookup(easing_inverse_tables[i], EASING_INVERSE_SIZE, x);
+	return easing_bezier_coordinate(easing_curves[i].y1, easing_curves[i].y2, t);
+}
+
+void easing_apply_group(easing_curve ease, float *x, int count) {
+	// Eases every x with the same curve, choosing the curve once for the whole group
+	for (int i = 0; i < count; i++) {
+		x[i] = x[i] < 0.0f? 0.0f : (x[i] > 1.0f? 1.0f : x[i]);
+	}
+	switch (ease) {
+		case EaseLinear:
+			return;
+		case EaseInQuad:
+			for (int i = 0; i < count; i++) x[i] = x[i] * x[i];
+			return;
+		case EaseOutQuad:
+			for (int i = 0; i < count; i++) {
+				float s = 1.0f - x[i];
+				x[i] = 1.0f - s * s;
+			}
+			return;
+		case EaseInCubic:
+			for (int i = 0; i < count; i++) x[i] = x[i] * x[i] * x[i];
+			return;
+		case EaseOutCubic:
+			for (int i = 0; i < count; i++) {
+				float s = 1.0f - x[i];
+				x[i] = 1.0f - s * s * s;
+			}
+			return;
+		case EaseOutBounce:
+			for (int i = 0; i < count; i++) x[i] = easing_table_lookup(easing_bounce_table, EASING_TABLE_SIZE, x[i]);
+			return;
+		case EaseOutElastic:
+			for (int i = 0; i < count; i++) x[i] = easing_table_lookup(easing_elastic_table, EASING_TABLE_SIZE, x[i]);
+			return;
+		case EaseBezier:
+			for (int i = 0; i < count; i++) x[i] = x[i] * x[i] * (3.0f - 2.0f * x[i]);
+			return;
+		default:
+			break;
+	}
+
+	int c = (int)ease - EaseCustom;
+	if (c < 0 || c >= easing_curve_count) return;
+	const float *table = easing_inverse_tables[c];
+	const float y1 = easing_curves[c].y1, y2 = easing_curves[c].y2;
+	for (int i = 0; i < count; i++) {
+		float t = easing_table_lookup(table, EASING_INVERSE_SIZE, x[i]);
+		x[i] = easing_bezier_coordinate(y1, y2, t);
+	}
+}
+
+void easing_apply_batch(const easing_curve *eases, float *x, int count) {
+	// Counting sort each chunk of values by curve, then ease each curve's values
+	// together in one loop and scatter them back.
+	uint16_t order[EASING_BATCH_SIZE];
+	float sorted[EASING_BATCH_SIZE];
+	int starts[EASING_CURVE_LIMIT + 1];
+	int next[EASING_CURVE_LIMIT];
+
+	for (int base = 0; base < count; base += EASING_BATCH_SIZE) {
+		const int n = count - base < EASING_BATCH_SIZE? count - base : EASING_BATCH_SIZE;
+		const easing_curve *chunk_eases = &eases[base];
+		float *chunk = &x[base];
+
+		// Curves that don't exist ease linearly, as in easing_apply()
+		memset(starts, 0, sizeof(starts));
+		for (int i = 0; i < n; i++) {
+			easing_curve ease = chunk_eases[i] < EASING_CURVE_LIMIT? chunk_eases[i] : EaseLinear;
+			starts[ease + 1]++;
+		}
+		for (int c = 0; c < EASING_CURVE_LIMIT; c++) {
+			starts[c + 1] += starts[c];
+		}
+		memcpy(next, starts, sizeof(next));
+		for (int i = 0; i < n; i++) {
+			easing_curve ease = chunk_eases[i] < EASING_CURVE_LIMIT? chunk_eases[i] : EaseLinear;
+			int j = next[ease]++;
+			order[j] = (uint16_t)i;
+			sorted[j] = chunk[i];
+		}
+
+		for (int c = 0; c < EASING_CURVE_LIMIT; c++) {
+			if (starts[c + 1] > starts[c]) {
+				easing_apply_group((easing_curve)c, &sorted[starts[c]], starts[c + 1] - starts[c]);
+			}
+		}
+		for (int j = 0; j < n; j++) {
+			chunk[order[j]] = sorted[j];
+		}
+	}
+}
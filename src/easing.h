@@ -0,0 +1,50 @@
+//
+//  easing.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Easing curves for animations. Curves that need transcendental functions or
+// several branches are sampled into tables by easing_init(), and cubic bezier
+// curves are looked up through a table of the bezier parameter for each x.
+
+#ifndef easing_h
+#define easing_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum: uint32_t {
+	EaseLinear,
+	EaseInQuad,
+	EaseOutQuad,
+	EaseInCubic,
+	EaseOutCubic,
+	EaseOutBounce,
+	EaseOutElastic,
+	EaseBezier,
+	EaseCustom, // first of the curves set by easing_set_curves()
+} easing_curve;
+
+// Cubic bezier from (0, 0) to (1, 1), like CSS cubic-bezier()
+typedef struct {
+	float x1, y1;
+	float x2, y2;
+} easing_bezier_t;
+
+#define EASING_MAX_CURVES (32)
+
+void easing_init(void);
+
+// Replaces the custom curves. x1 and x2 must be within 0...1.
+bool easing_set_curves(const easing_bezier_t *curves, int count);
+bool easing_bezier_is_valid(const easing_bezier_t *curve);
+
+// x is clamped to 0...1
+float easing_apply(easing_curve ease, float x);
+
+// Eases each x in place. The values are grouped by curve, so each curve is
+// chosen once per group rather than once per value.
+void easing_apply_batch(const easing_curve *eases, float *x, int count);
+
+#endif /* easing_h */
@@ -0,0 +1,88 @@
+//
+//  hot_reload.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "hot_reload.h"
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+#define HOT_RELOAD_MAX_FILES (16)
+#define HOT_RELOAD_PATH_LENGTH (256)
+#define HOT_RELOAD_INTERVAL (250) // milliseconds between checks
+
+typedef struct {
+	char path[HOT_RELOAD_PATH_LENGTH];
+	hot_reload_callback_t callback;
+	void *context;
+	int64_t size;
+	int64_t modified; // nanoseconds, since an editor can save twice within one second
+} hot_reload_file_t;
+
+// Globals
+bool hot_reload_enabled = false;
+hot_reload_file_t hot_reload_files[HOT_RELOAD_MAX_FILES];
+int hot_reload_file_count = 0;
+uint64_t hot_reload_last_check = 0;
+
+
+bool hot_reload_stat(const char *path, int64_t *size, int64_t *modified) {
+	struct stat s;
+	if (stat(path, &s) != 0) return false;
+	*size = (int64_t)s.st_size;
+#ifdef __APPLE__
+	*modified = (int64_t)s.st_mtimespec.tv_sec * 1000000000 + (int64_t)s.st_mtimespec.tv_nsec;
+#else
+	*modified = (int64_t)s.st_mtim.tv_sec * 1000000000 + (int64_t)s.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool hot_reload_watch(const char *path, hot_reload_callback_t callback, void *context) {
+	if (!hot_reload_enabled) return false;
+	if (hot_reload_file_count >= HOT_RELOAD_MAX_FILES || strlen(path) >= HOT_RELOAD_PATH_LENGTH) {
+		fprintf(stderr, "Unable to watch %s!\n", path);
+		return false;
+	}
+
+	hot_reload_file_t *file = &hot_reload_files[hot_reload_file_count];
+	strcpy(file->path, path);
+	file->callback = callback;
+	file->context = context;
+	if (!hot_reload_stat(path, &file->size, &file->modified)) {
+		file->size = -1;
+		file->modified = -1;
+	}
+	hot_reload_file_count++;
+	return true;
+}
+
+void hot_reload_poll(void) {
+	if (!hot_reload_enabled) return;
+	uint64_t now = SDL_GetTicks64();
+	if (now - hot_reload_last_check < HOT_RELOAD_INTERVAL) return;
+	hot_reload_last_check = now;
+
+	for (int i = 0; i < hot_reload_file_count; i++) {
+		hot_reload_file_t *file = &hot_reload_files[i];
+		int64_t size, modified;
+		// Files that are missing, e.g. while an editor replaces them, are checked again later
+		if (!hot_reload_stat(file->path, &size, &modified)) continue;
+		if (size == file->size && modified == file->modified) continue;
+		file->size = size;
+		file->modified = modified;
+
+		uint64_t start = SDL_GetPerformanceCounter();
+		if (file->callback(file->path, file->context)) {
+			double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+			fprintf(stdout, "Reloaded %s in %.2fms.\n", file->path, ms);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+//
+//  hot_reload.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Dev mode file watching. Watched files are checked a few times a second,
+// and each one's callback runs from the game loop between frames once the
+// file changes, so callbacks can swap in new data without any locking.
+
+#ifndef hot_reload_h
+#define hot_reload_h
+
+#include <stdbool.h>
+
+// Returns false if the file couldn't be loaded, leaving the previous data in place
+typedef bool (*hot_reload_callback_t)(const char *path, void *context);
+
+// Set by main() before anything is loaded, when run with --dev
+extern bool hot_reload_enabled;
+
+bool hot_reload_watch(const char *path, hot_reload_callback_t callback, void *context);
+void hot_reload_poll(void);
+
+#endif /* hot_reload_h */
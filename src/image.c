@@ -7,6 +7,7 @@
 
 #include "image.h"
 #include "drawing.h"
+#include "hot_reload.h"
 #include "vector.h"
 
 #include <SDL2/SDL.h>
@@ -18,11 +19,24 @@
 image_t *image_title_background = NULL;
 image_t *image_basic_background = NULL;
 
+bool image_reload(const char *path, void *context) {
+	// Replace the image only once the new file has loaded
+	image_t **image = context;
+	image_t *new_image = load_bmp_image(path);
+	if (!new_image) return false;
+	if (*image) free_image(*image);
+	*image = new_image;
+	return true;
+}
+
 void image_init(void) {
 	image_title_background = load_bmp_image("assets/title_background.bmp");
 	if (!image_title_background) fprintf(stderr, "image_title_background could not be loaded!\n");
 	image_basic_background = load_bmp_image("assets/basic_background.bmp");
 	if (!image_basic_background) fprintf(stderr, "image_basic_background could not be loaded!\n");
+	
+	hot_reload_watch("assets/title_background.bmp", image_reload, &image_title_background);
+	hot_reload_watch("assets/basic_background.bmp", image_reload, &image_basic_background);
 }
 
 #pragma mark - File I/O
@@ -10,13 +10,18 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
 
+#include "arena.h"
 #include "atari_text.h"
 #include "audio_player.h"
 #include "color.h"
 #include "drawing.h"
+#include "easing.h"
+#include "hot_reload.h"
 #include "image.h"
 #include "matrix.h"
+#include "offline_render.h"
 #include "scene_manager.h"
 #include "vector.h"
 
@@ -27,6 +32,7 @@
 
 // Constants
 #define FRAME_TARGET_TIME (1000 / 60)
+#define MAX_UPDATE_STEPS (8)
 #define PIXELS_WIDTH (320)
 #define PIXELS_HEIGHT (200)
 #define PIXELS_SCALE (2)
@@ -35,6 +41,7 @@
 // Globals
 bool is_running = true;
 uint64_t last_update_time = 0;
+double update_accumulator = 0.0;
 
 
 #pragma mark - Audio Volume
@@ -52,7 +59,7 @@ void process_keyboard_input(void) {
 	SDL_PollEvent(&event);
 	bool handled = false;
 	
-	switch (scene_index) {
+	switch (scene_context->index) {
 		case SCENE_TITLE:
 			handled = title_handle_keyboard(event);
 			break;
@@ -100,8 +107,20 @@ void process_keyboard_input(void) {
 }
 
 void update_state(uint64_t delta_time) {
-	double x = (double)delta_time / 1000.0;
-	update_scene(x);
+	// Simulate in fixed steps so physics doesn't depend on the frame rate
+	update_accumulator += (double)delta_time / 1000.0;
+	int steps = 0;
+	while (update_accumulator >= UPDATE_STEP_TIME && steps < MAX_UPDATE_STEPS) {
+		update_scene(UPDATE_STEP_TIME);
+		update_accumulator -= UPDATE_STEP_TIME;
+		steps++;
+	}
+	
+	// After a long stall, drop the time that couldn't be caught up instead of spiraling
+	if (update_accumulator >= UPDATE_STEP_TIME) {
+		update_accumulator = fmod(update_accumulator, UPDATE_STEP_TIME);
+	}
+	scene_context->render_interpolation = (float)(update_accumulator / UPDATE_STEP_TIME);
 }
 
 void draw_volume_overlay(void) {
@@ -134,6 +153,10 @@ void run_render_pipeline(void) {
 void run_game_loop(void) {
 	// Run one iteration of game loop
 	uint64_t update_start_time = SDL_GetTicks64();
+	
+	// Release transient buffers from the previous frame
+	arena_reset(&frame_arena);
+	hot_reload_poll();
 	uint64_t delta_time = update_start_time - last_update_time;
 	
 	// Run one iteration of game loop
@@ -159,13 +182,52 @@ void run_game_loop(void) {
 	last_update_time = update_start_time;
 }
 
+int render_offline(const char *path, int fps, int thread_count) {
+	// Render the show to a file without a window or audio. The images and the
+	// show are loaded here once, and the workers set up their own scenes.
+	hot_reload_enabled = false;
+	if (!init_frame_buffer(PIXELS_WIDTH, PIXELS_HEIGHT)) return 1;
+	if (!init_offline_audio()) return 1;
+	if (!atari_text_init()) return 1;
+	easing_init();
+	image_init();
+	gameplay_load_show();
+	bool success = offline_render_show(path, fps, thread_count);
+	gameplay_free_show();
+	return success? 0 : 1;
+}
+
 int main(int argc, const char * argv[]) {
+#ifndef __EMSCRIPTEN__
+	// --dev reloads the timeline and images when they change on disk, and
+	// --render writes the whole show to a video or images and exits
+	const char *render_path = NULL;
+	int render_fps = 30;
+	int render_threads = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--dev") == 0) {
+			hot_reload_enabled = true;
+		} else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+			render_path = argv[++i];
+		} else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+			render_fps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			render_threads = atoi(argv[++i]);
+		}
+	}
+	if (render_path) {
+		return render_offline(render_path, render_fps, render_threads);
+	}
+#endif
+	
 	if (!init_screen(PIXELS_WIDTH, PIXELS_HEIGHT, PIXELS_SCALE)) return 0;
 	if (!init_audio()) return 0;
 	if (!atari_text_init()) return 0;
+	easing_init();
 
 	// Init all scenes
 	image_init();
+	gameplay_load_show();
 	scene_manager_init();
 	
 	set_scene_index(SCENE_TITLE);
@@ -20,30 +20,32 @@ mat3_t mat3_identity(void) {
 }
 
 mat3_t mat3_translate(mat3_t m, vec2_t t) {
-	mat3_t n = {
-		1, 0, t.x,
-		0, 1, t.y,
-		0, 0, 1
-	};
-	return mat3_multiply(m, n);
+	// Same as multiplying by a translation matrix, which only changes the last column
+	for (int i = 0; i < 3; i++) {
+		m.m[i][2] += m.m[i][0] * t.x + m.m[i][1] * t.y;
+	}
+	return m;
 }
 
 mat3_t mat3_scale(mat3_t m, vec2_t s) {
-	mat3_t n = {
-		s.x, 0, 0,
-		0, s.y, 0,
-		0, 0, 1
-	};
-	return mat3_multiply(m, n);
+	// Same as multiplying by a scale matrix, which only scales the first two columns
+	for (int i = 0; i < 3; i++) {
+		m.m[i][0] *= s.x;
+		m.m[i][1] *= s.y;
+	}
+	return m;
 }
 
 mat3_t mat3_rotate(mat3_t m, float a) {
-	mat3_t n = {
-		cosf(a), -sinf(a), 0,
-		sinf(a), cosf(a), 0,
-		0, 0, 1
-	};
-	return mat3_multiply(m, n);
+	const float c = cosf(a);
+	const float s = sinf(a);
+	for (int i = 0; i < 3; i++) {
+		float x = m.m[i][0];
+		float y = m.m[i][1];
+		m.m[i][0] = x * c + y * s;
+		m.m[i][1] = y * c - x * s;
+	}
+	return m;
 }
 
 mat3_t mat3_multiply(const mat3_t a, const mat3_t b) {
@@ -81,53 +83,59 @@ mat4_t mat4_identity(void) {
 }
 
 mat4_t mat4_translate(mat4_t m, vec3_t t) {
-	mat4_t n = {
-		1, 0, 0, t.x,
-		0, 1, 0, t.y,
-		0, 0, 1, t.z,
-		0, 0, 0, 1
-	};
-	return mat4_multiply(m, n);
+	// Same as multiplying by a translation matrix, which only changes the last column
+	for (int i = 0; i < 4; i++) {
+		m.m[i][3] += m.m[i][0] * t.x + m.m[i][1] * t.y + m.m[i][2] * t.z;
+	}
+	return m;
 }
 
 mat4_t mat4_scale(mat4_t m, vec3_t s) {
-	mat4_t n = {
-		s.x, 0, 0, 0,
-		0, s.y, 0, 0,
-		0, 0, s.z, 0,
-		0, 0, 0, 1
-	};
-	return mat4_multiply(m, n);
+	// Same as multiplying by a scale matrix, which only scales the first three columns
+	for (int i = 0; i < 4; i++) {
+		m.m[i][0] *= s.x;
+		m.m[i][1] *= s.y;
+		m.m[i][2] *= s.z;
+	}
+	return m;
 }
 
+// Rotations only mix two columns of the matrix, so they are applied directly.
+
 mat4_t mat4_pitch(mat4_t m, float a) {
-	mat4_t n = {
-		1, 0, 0, 0,
-		0, cosf(a), -sinf(a), 0,
-		0, sinf(a), cosf(a), 0,
-		0, 0, 0, 1
-	};
-	return mat4_multiply(m, n);
+	const float c = cosf(a);
+	const float s = sinf(a);
+	for (int i = 0; i < 4; i++) {
+		float y = m.m[i][1];
+		float z = m.m[i][2];
+		m.m[i][1] = y * c + z * s;
+		m.m[i][2] = z * c - y * s;
+	}
+	return m;
 }
 
 mat4_t mat4_roll(mat4_t m, float a) {
-	mat4_t n = {
-		cosf(a), -sinf(a), 0, 0,
-		sinf(a), cosf(a), 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	};
-	return mat4_multiply(m, n);
+	const float c = cosf(a);
+	const float s = sinf(a);
+	for (int i = 0; i < 4; i++) {
+		float x = m.m[i][0];
+		float y = m.m[i][1];
+		m.m[i][0] = x * c + y * s;
+		m.m[i][1] = y * c - x * s;
+	}
+	return m;
 }
 
 mat4_t mat4_yaw(mat4_t m, float a) {
-	mat4_t n = {
-		 cosf(a), 0, sinf(a), 0,
-		 0, 1, 0, 0,
-		 -sinf(a), 0, cosf(a), 0,
-		 0, 0, 0, 1
-	 };
-	return mat4_multiply(m, n);
+	const float c = cosf(a);
+	const float s = sinf(a);
+	for (int i = 0; i < 4; i++) {
+		float x = m.m[i][0];
+		float z = m.m[i][2];
+		m.m[i][0] = x * c - z * s;
+		m.m[i][2] = x * s + z * c;
+	}
+	return m;
 }
 
 mat4_t mat4_apply_euler_angles(mat4_t m, vec3_t a) {
@@ -162,3 +170,111 @@ vec3_t vec3_mat4_multiply(const vec3_t v, const mat4_t m) {
 	vec3_t result = { c[0], c[1], c[2] };
 	return result;
 }
+
+#pragma mark - 2D Affine
+
+affine2_t affine2_identity(void) {
+	affine2_t m = {
+		1, 0, 0,
+		0, 1, 0
+	};
+	return m;
+}
+
+affine2_t affine2_make(vec2_t translation, float rotation, vec2_t scale) {
+	// Equivalent to translate * rotate * scale, built in one step
+	const float c = cosf(rotation);
+	const float s = sinf(rotation);
+	affine2_t m = {
+		c * scale.x, -s * scale.y, translation.x,
+		s * scale.x, c * scale.y, translation.y
+	};
+	return m;
+}
+
+affine2_t affine2_multiply(const affine2_t a, const affine2_t b) {
+	affine2_t c;
+	for (int i = 0; i < 2; i++) {
+		c.m[i][0] = a.m[i][0] * b.m[0][0] + a.m[i][1] * b.m[1][0];
+		c.m[i][1] = a.m[i][0] * b.m[0][1] + a.m[i][1] * b.m[1][1];
+		c.m[i][2] = a.m[i][0] * b.m[0][2] + a.m[i][1] * b.m[1][2] + a.m[i][2];
+	}
+	return c;
+}
+
+vec2_t vec2_affine2_multiply(const vec2_t v, const affine2_t m) {
+	vec2_t b;
+	b.x = m.m[0][0] * v.x + m.m[0][1] * v.y + m.m[0][2];
+	b.y = m.m[1][0] * v.x + m.m[1][1] * v.y + m.m[1][2];
+	return b;
+}
+
+#pragma mark - 3D Affine
+
+affine3_t affine3_identity(void) {
+	affine3_t m = {
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0
+	};
+	return m;
+}
+
+affine3_t affine3_make(vec3_t translation, vec3_t rotation, vec3_t scale) {
+	// Equivalent to translate * yaw * pitch * roll * scale, built in one step.
+	// See mat4_apply_euler_angles() for the order of rotations.
+	const float cx = cosf(rotation.x), sx = sinf(rotation.x);
+	const float cy = cosf(rotation.y), sy = sinf(rotation.y);
+	const float cz = cosf(rotation.z), sz = sinf(rotation.z);
+	affine3_t m = {
+		(cy * cz + sy * sx * sz) * scale.x, (sy * sx * cz - cy * sz) * scale.y, sy * cx * scale.z, translation.x,
+		cx * sz * scale.x, cx * cz * scale.y, -sx * scale.z, translation.y,
+		(cy * sx * sz - sy * cz) * scale.x, (sy * sz + cy * sx * cz) * scale.y, cy * cx * scale.z, translation.z
+	};
+	return m;
+}
+
+affine3_t affine3_multiply(const affine3_t a, const affine3_t b) {
+	affine3_t c;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			c.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+		}
+		c.m[i][3] += a.m[i][3];
+	}
+	return c;
+}
+
+affine3_t affine3_inverse(const affine3_t m) {
+	// Inverse of the 3x3 part via its adjugate, then the translation
+	const float det = affine3_determinant(m);
+	const float inv_det = (det != 0.0f)? 1.0f / det : 0.0f;
+	affine3_t r;
+	r.m[0][0] = (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1]) * inv_det;
+	r.m[0][1] = (m.m[0][2] * m.m[2][1] - m.m[0][1] * m.m[2][2]) * inv_det;
+	r.m[0][2] = (m.m[0][1] * m.m[1][2] - m.m[0][2] * m.m[1][1]) * inv_det;
+	r.m[1][0] = (m.m[1][2] * m.m[2][0] - m.m[1][0] * m.m[2][2]) * inv_det;
+	r.m[1][1] = (m.m[0][0] * m.m[2][2] - m.m[0][2] * m.m[2][0]) * inv_det;
+	r.m[1][2] = (m.m[0][2] * m.m[1][0] - m.m[0][0] * m.m[1][2]) * inv_det;
+	r.m[2][0] = (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]) * inv_det;
+	r.m[2][1] = (m.m[0][1] * m.m[2][0] - m.m[0][0] * m.m[2][1]) * inv_det;
+	r.m[2][2] = (m.m[0][0] * m.m[1][1] - m.m[0][1] * m.m[1][0]) * inv_det;
+	for (int i = 0; i < 3; i++) {
+		r.m[i][3] = -(r.m[i][0] * m.m[0][3] + r.m[i][1] * m.m[1][3] + r.m[i][2] * m.m[2][3]);
+	}
+	return r;
+}
+
+float affine3_determinant(const affine3_t m) {
+	return m.m[0][0] * (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1])
+		- m.m[0][1] * (m.m[1][0] * m.m[2][2] - m.m[1][2] * m.m[2][0])
+		+ m.m[0][2] * (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]);
+}
+
+vec3_t vec3_affine3_multiply(const vec3_t v, const affine3_t m) {
+	vec3_t b;
+	b.x = m.m[0][0] * v.x + m.m[0][1] * v.y + m.m[0][2] * v.z + m.m[0][3];
+	b.y = m.m[1][0] * v.x + m.m[1][1] * v.y + m.m[1][2] * v.z + m.m[1][3];
+	b.z = m.m[2][0] * v.x + m.m[2][1] * v.y + m.m[2][2] * v.z + m.m[2][3];
+	return b;
+}
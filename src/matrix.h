@@ -20,6 +20,16 @@ typedef struct {
 	float m[4][4];
 } mat4_t;
 
+// Affine transform types: the last row is implicitly (0, 0, 1) or (0, 0, 0, 1)
+
+typedef struct {
+	float m[2][3];
+} affine2_t;
+
+typedef struct {
+	float m[3][4];
+} affine3_t;
+
 // 2D Matrix Functions
 mat3_t mat3_identity(void);
 mat3_t mat3_translate(mat3_t m, vec2_t t);
@@ -39,4 +49,18 @@ mat4_t mat4_apply_euler_angles(mat4_t m, vec3_t a);
 mat4_t mat4_multiply(const mat4_t a, const mat4_t b);
 vec3_t vec3_mat4_multiply(const vec3_t v, const mat4_t m);
 
+// 2D Affine Functions
+affine2_t affine2_identity(void);
+affine2_t affine2_make(vec2_t translation, float rotation, vec2_t scale);
+affine2_t affine2_multiply(const affine2_t a, const affine2_t b);
+vec2_t vec2_affine2_multiply(const vec2_t v, const affine2_t m);
+
+// 3D Affine Functions
+affine3_t affine3_identity(void);
+affine3_t affine3_make(vec3_t translation, vec3_t rotation, vec3_t scale);
+affine3_t affine3_multiply(const affine3_t a, const affine3_t b);
+affine3_t affine3_inverse(const affine3_t m);
+float affine3_determinant(const affine3_t m);
+vec3_t vec3_affine3_multiply(const vec3_t v, const affine3_t m);
+
 #endif /* matrix_h */
@@ -8,45 +8,89 @@
 #include "mesh.h"
 #include "color.h"
 #include "drawing.h"
-#include "array_list.h"
+#include "arena.h"
+#include "physics.h"
+#include "pool.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 
-mesh_face_t mesh_face_make(vec3_t a, vec3_t b, vec3_t c) {
+// Meshes allocated outside of a scene arena
+_Thread_local pool_t mesh_pool = POOL_INIT(mesh_t, 64);
+
+// Ratio a mesh's screen radius must exceed a threshold by to switch back to more detail
+#define MESH_LOD_HYSTERESIS (1.25f)
+
+// Scratch buffer of projected vertices, shared by all meshes while drawing.
+// A vertex is transformed the first time a visible face uses it, marked with the current stamp,
+// and added to the list of visible vertices so its point is drawn only once.
+_Thread_local vec2_t *mesh_projected_vertices = NULL;
+_Thread_local uint32_t *mesh_projected_stamps = NULL;
+_Thread_local int *mesh_visible_vertices = NULL;
+_Thread_local int mesh_visible_vertex_count = 0;
+_Thread_local int mesh_projected_capacity = 0;
+_Thread_local uint32_t mesh_projected_stamp = 0;
+
+_Thread_local uint32_t mesh_tree_version = 0;
+
+
+mesh_face_t mesh_face_make(const vec3_t *vertices, int a, int b, int c) {
 	mesh_face_t face = { a, b, c };
+	vec3_t va = vertices[a];
+	face.normal = vec3_cross(vec3_sub(vertices[b], va), vec3_sub(vertices[c], va));
+	face.distance = vec3_dot(face.normal, va);
 	return face;
 }
 
-mesh_t *mesh_new(int face_count) {
-	mesh_t *mesh = malloc(sizeof(mesh_t));
+mesh_t *mesh_new(int vertex_count, int face_count) {
+	// Meshes created while a scene arena is set live entirely in that arena.
+	// Otherwise the mesh comes from the mesh pool and its arrays from the heap.
+	arena_t *arena = scene_arena;
+	mesh_t *mesh = arena? arena_alloc(arena, sizeof(mesh_t)) : pool_alloc(&mesh_pool);
 	if (!mesh) {
 		fprintf(stderr, "Unable to allocate mesh!\n");
 		return NULL;
 	}
+	mesh->arena = arena;
+	mesh->vertices = NULL;
+	mesh->faces = NULL;
+	mesh_list_init(&mesh->children, arena);
+	mesh->lower_detail = NULL;
+	if (vertex_count > 0) {
+		mesh->vertices = arena_or_heap_alloc(arena, sizeof(vec3_t) * (size_t)vertex_count);
+		if (!mesh->vertices) {
+			fprintf(stderr, "Unable to allocate mesh vertices!\n");
+			mesh_destroy(mesh);
+			return NULL;
+		}
+	}
 	if (face_count > 0) {
-		mesh_face_t *faces = malloc(sizeof(mesh_face_t) * (size_t)face_count);
-		if (!faces) {
+		mesh->faces = arena_or_heap_alloc(arena, sizeof(mesh_face_t) * (size_t)face_count);
+		if (!mesh->faces) {
 			fprintf(stderr, "Unable to allocate mesh faces!\n");
-			free(mesh);
+			mesh_destroy(mesh);
 			return NULL;
 		}
-		mesh->faces = faces;
-	} else {
-		mesh->faces = NULL;
 	}
 	
+	mesh->vertex_count = vertex_count;
 	mesh->face_count = face_count;
 	mesh->faces_are_lines = false;
-	mesh->children = NULL;
+	
+	// Level of detail
+	mesh->lod_min_screen_radius = 0.0f;
+	mesh->lod_bounding_radius = 0.0f;
+	mesh->lod_level = 0;
 	
 	// Visuals
 	mesh->is_visible = true;
 	mesh->use_backface_culling = true;
 	mesh->line_color = COLOR_ABGR_WHITE;
 	mesh->point_color = 0;
+	mesh->round_points = false;
 	mesh->opacity = 1.0f;
 	
 	// Physics
@@ -57,174 +101,848 @@ mesh_t *mesh_new(int face_count) {
 	mesh->angular_momentum = vec3_zero(); // radians/second
 	mesh->gravity = false;
 	mesh->lifetime = 0.0;
+	
+	// Transforms are calculated on first draw
+	mesh->local_transform = affine3_identity();
+	mesh->world_transform = affine3_identity();
+	mesh->transform_dirty = true;
+	
+	mesh->graph = NULL;
+	mesh->graph_index = -1;
 	return mesh;
 }
 
 void mesh_destroy(mesh_t *mesh) {
-	if (mesh->children) {
-		mesh_t **a = (mesh_t **)mesh->children->array;
-		int n = mesh->children->length;
-		for (int i=0; i<n; i++) {
-			mesh_destroy(a[i]);
-		}
-		array_list_destroy(mesh->children);
+	// Arena meshes are freed along with their arena
+	if (mesh->arena) return;
+	
+	for (int i=0; i<mesh->children.length; i++) {
+		mesh_destroy(mesh->children.array[i]);
 	}
+	mesh_list_free(&mesh->children);
+	if (mesh->lower_detail) mesh_destroy(mesh->lower_detail);
 
+	if (mesh->vertices) free(mesh->vertices);
 	if (mesh->faces) free(mesh->faces);
-	free(mesh);
+	pool_free(&mesh_pool, mesh);
 }
 
 bool mesh_add_child(mesh_t *mesh, mesh_t *child) {
-	if (!mesh->children) {
-		mesh->children = array_list_new(4);
-		if (!mesh->children) return false;
-	}
-	return array_list_add(mesh->children, child);
+	mesh_tree_version++;
+	return mesh_list_add(&mesh->children, child);
 }
 
 void mesh_set_children_color(mesh_t *mesh, uint32_t line, uint32_t point) {
 	mesh->line_color = line;
 	mesh->point_color = point;
 
-	if (mesh->children) {
-		mesh_t **a = (mesh_t **)mesh->children->array;
-		int n = mesh->children->length;
-		for (int i=0; i<n; i++) {
-			mesh_set_children_color(a[i], line, point);
-		}
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		mesh_set_children_color(a[i], line, point);
 	}
 }
 
+void mesh_set_lower_detail(mesh_t *mesh, mesh_t *lower_detail, float min_screen_radius) {
+	// The mesh takes ownership of the lower detail geometry, which can have its own lower detail
+	if (mesh->lower_detail) mesh_destroy(mesh->lower_detail);
+	mesh->lower_detail = lower_detail;
+	mesh->lod_min_screen_radius = min_screen_radius;
+	mesh->lod_level = 0;
+	
+	float r2 = 0.0f;
+	for (int i = 0; i < mesh->vertex_count; i++) {
+		r2 = fmaxf(r2, vec3_dot(mesh->vertices[i], mesh->vertices[i]));
+	}
+	mesh->lod_bounding_radius = sqrtf(r2);
+}
+
 #pragma mark -
 
 void mesh_reset_momentum(mesh_t *mesh) {
-	mesh->linear_momentum = vec3_zero();
-	mesh->angular_momentum = vec3_zero();
+	mesh_set_linear_momentum(mesh, vec3_zero());
+	mesh_set_angular_momentum(mesh, vec3_zero());
+}
+
+void mesh_set_position(mesh_t *mesh, vec3_t position) {
+	if (mesh->graph) {
+		mesh->graph->positions[mesh->graph_index] = position;
+	} else {
+		mesh->position = position;
+	}
+	mesh->transform_dirty = true;
+}
+
+void mesh_set_rotation(mesh_t *mesh, vec3_t rotation) {
+	if (mesh->graph) {
+		mesh->graph->rotations[mesh->graph_index] = rotation;
+	} else {
+		mesh->rotation = rotation;
+	}
+	mesh->transform_dirty = true;
+}
+
+void mesh_set_scale(mesh_t *mesh, vec3_t scale) {
+	mesh->scale = scale;
+	mesh->transform_dirty = true;
 }
 
 void mesh_set_rotation_degrees(mesh_t *mesh, vec3_t deg) {
-	mesh->rotation = vec3_mul(deg, (float)M_PI / 180.0f);
+	mesh_set_rotation(mesh, vec3_mul(deg, (float)M_PI / 180.0f));
 }
 
 void mesh_set_angular_momentum_degrees(mesh_t *mesh, vec3_t deg) {
-	mesh->angular_momentum = vec3_mul(deg, (float)M_PI / 180.0f);
+	mesh_set_angular_momentum(mesh, vec3_mul(deg, (float)M_PI / 180.0f));
+}
+
+void mesh_set_linear_momentum(mesh_t *mesh, vec3_t momentum) {
+	if (mesh->graph) {
+		mesh->graph->linear_momenta[mesh->graph_index] = momentum;
+	} else {
+		mesh->linear_momentum = momentum;
+	}
+}
+
+void mesh_set_angular_momentum(mesh_t *mesh, vec3_t momentum) {
+	if (mesh->graph) {
+		mesh->graph->angular_momenta[mesh->graph_index] = momentum;
+	} else {
+		mesh->angular_momentum = momentum;
+	}
+}
+
+void mesh_set_gravity(mesh_t *mesh, bool gravity) {
+	if (mesh->graph) {
+		mesh->graph->gravity[mesh->graph_index] = gravity;
+	} else {
+		mesh->gravity = gravity;
+	}
+}
+
+vec3_t mesh_get_position(const mesh_t *mesh) {
+	return mesh->graph? mesh->graph->positions[mesh->graph_index] : mesh->position;
+}
+
+vec3_t mesh_get_rotation(const mesh_t *mesh) {
+	return mesh->graph? mesh->graph->rotations[mesh->graph_index] : mesh->rotation;
+}
+
+vec3_t mesh_get_linear_momentum(const mesh_t *mesh) {
+	return mesh->graph? mesh->graph->linear_momenta[mesh->graph_index] : mesh->linear_momentum;
+}
+
+vec3_t mesh_get_angular_momentum(const mesh_t *mesh) {
+	return mesh->graph? mesh->graph->angular_momenta[mesh->graph_index] : mesh->angular_momentum;
 }
 
 #pragma mark -
 
 void mesh_update(mesh_t *mesh, double delta_time) {
 	// Update children
-	if (mesh->children) {
-		mesh_t **a = (mesh_t **)mesh->children->array;
-		int n = mesh->children->length;
-		for (int i=0; i<n; i++) {
-			mesh_update(a[i], delta_time);
-		}
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		mesh_update(a[i], delta_time);
 	}
+	mesh_integrate(mesh, delta_time);
+}
 
+void mesh_integrate(mesh_t *mesh, double delta_time) {
 	// Update posiiton & rotation
 	float dt = (float)delta_time;
 	
 	// Acceleration due to gravity
 	if (mesh->gravity) {
-		mesh->linear_momentum.y -= 9.8f * dt;
+		mesh->linear_momentum.y -= PHYSICS_GRAVITY * dt;
 	}
 	
-	mesh->position = vec3_add(mesh->position, vec3_mul(mesh->linear_momentum, dt));
-	mesh->rotation = vec3_add(mesh->rotation, mesh->angular_momentum);
+	// Only moving meshes need their transforms recalculated
+	if (!vec3_is_zero(mesh->linear_momentum)) {
+		mesh->position = vec3_add(mesh->position, vec3_mul(mesh->linear_momentum, dt));
+		mesh->transform_dirty = true;
+	}
+	if (!vec3_is_zero(mesh->angular_momentum)) {
+		mesh->rotation = vec3_add(mesh->rotation, vec3_mul(mesh->angular_momentum, dt));
+		mesh->transform_dirty = true;
+	}
 	mesh->lifetime += delta_time;
 }
 
-void mesh_draw(mesh_t *mesh) {
-	mesh_draw_recursive(mesh, mat4_identity(), 1.0f);
+const mesh_t *mesh_select_lod(mesh_t *mesh, const affine3_t *transform) {
+	if (!mesh->lower_detail) return mesh;
+	
+	// Radius on screen in pixels, using the largest scale of the transform
+	const float z = transform->m[2][3];
+	if (z <= 0.0f) return mesh;
+	float scale2 = 0.0f;
+	for (int j = 0; j < 3; j++) {
+		vec3_t column = { transform->m[0][j], transform->m[1][j], transform->m[2][j] };
+		scale2 = fmaxf(scale2, vec3_dot(column, column));
+	}
+	const float view_scale = fabsf(draw_context->view_transform_2d.m[1][1]);
+	const float radius = mesh->lod_bounding_radius * sqrtf(scale2) / z * view_scale;
+	
+	// Drop detail below each level's threshold, but only add detail back once the radius
+	// is clearly above it, so a mesh near a threshold doesn't flicker between levels.
+	const mesh_t *geometry = mesh;
+	int level = 0;
+	while (geometry->lower_detail) {
+		float threshold = geometry->lod_min_screen_radius;
+		if (level < mesh->lod_level) threshold *= MESH_LOD_HYSTERESIS;
+		if (radius >= threshold) break;
+		geometry = geometry->lower_detail;
+		level++;
+	}
+	mesh->lod_level = level;
+	return geometry;
 }
 
-void mesh_draw_recursive(mesh_t *mesh, mat4_t transform, float opacity) {
-	if (!mesh->is_visible) return;
+bool mesh_reserve_projected_vertices(int count) {
+	if (count <= mesh_projected_capacity) return true;
 	
-	// Tranformation matrix
-	transform = mat4_translate(transform, mesh->position);
-	transform = mat4_apply_euler_angles(transform, mesh->rotation);
-	transform = mat4_scale(transform, mesh->scale);
+	vec2_t *vertices = realloc(mesh_projected_vertices, sizeof(vec2_t) * (size_t)count);
+	if (!vertices) {
+		fprintf(stderr, "Unable to allocate projected vertices!\n");
+		return false;
+	}
+	mesh_projected_vertices = vertices;
 	
-	// Opacity
-	opacity = opacity * mesh->opacity;
+	uint32_t *stamps = realloc(mesh_projected_stamps, sizeof(uint32_t) * (size_t)count);
+	if (!stamps) {
+		fprintf(stderr, "Unable to allocate projected vertices!\n");
+		return false;
+	}
+	memset(stamps + mesh_projected_capacity, 0, sizeof(uint32_t) * (size_t)(count - mesh_projected_capacity));
+	mesh_projected_stamps = stamps;
+	
+	int *visible = realloc(mesh_visible_vertices, sizeof(int) * (size_t)count);
+	if (!visible) {
+		fprintf(stderr, "Unable to allocate projected vertices!\n");
+		return false;
+	}
+	mesh_visible_vertices = visible;
+	mesh_projected_capacity = count;
+	return true;
+}
 
-	if (mesh->face_count > 0 && mesh->faces) {
-		vec3_t a3, b3, c3;
-		vec2_t a2, b2, c2;
-		vec3_t vab, vac, normal, camera_ray;
-		float dot_normal_camera;
-		const vec3_t camera_pos = get_camera_position();
-		const int point_w = 3;
+void mesh_free_projected_vertices(void) {
+	free(mesh_projected_vertices);
+	free(mesh_projected_stamps);
+	free(mesh_visible_vertices);
+	mesh_projected_vertices = NULL;
+	mesh_projected_stamps = NULL;
+	mesh_visible_vertices = NULL;
+	mesh_visible_vertex_count = 0;
+	mesh_projected_capacity = 0;
+}
+
+vec2_t mesh_project_vertex(const mesh_t *mesh, int index, const affine3_t *transform) {
+	if (mesh_projected_stamps[index] != mesh_projected_stamp) {
+		vec3_t v = vec3_affine3_multiply(mesh->vertices[index], *transform);
+		mesh_projected_vertices[index] = perspective_project_camera_point(v);
+		mesh_projected_stamps[index] = mesh_projected_stamp;
+		mesh_visible_vertices[mesh_visible_vertex_count++] = index;
+	}
+	return mesh_projected_vertices[index];
+}
+
+void mesh_draw_faces(mesh_t *mesh, const affine3_t *world_transform, float opacity) {
+	vec2_t a2, b2, c2;
+	
+	// Transform vertices directly into camera space, where the camera is at the origin
+	const affine3_t transform = affine3_multiply(draw_context->camera_transform_3d, *world_transform);
+	
+	// Use less detailed geometry when the mesh is small on screen
+	const mesh_t *geometry = mesh_select_lod(mesh, &transform);
+	if (!mesh_reserve_projected_vertices(geometry->vertex_count)) return;
+	
+	// Backface culling is done in object space, so bring the camera into object space once per mesh.
+	// A mirroring transform flips the winding of every face.
+	const bool use_culling = mesh->use_backface_culling && !mesh->faces_are_lines;
+	const vec3_t camera_pos = vec3_affine3_multiply(vec3_zero(), affine3_inverse(transform));
+	const float winding = (affine3_determinant(transform) < 0.0f)? -1.0f : 1.0f;
+	
+	// Invalidate projected vertices from the previous mesh
+	mesh_projected_stamp++;
+	if (mesh_projected_stamp == 0) {
+		memset(mesh_projected_stamps, 0, sizeof(uint32_t) * (size_t)mesh_projected_capacity);
+		mesh_projected_stamp = 1;
+	}
+	mesh_visible_vertex_count = 0;
+	
+	// Color
+	set_line_color_abgr(color_mul_opacity(mesh->line_color, opacity));
+	set_fill_color_abgr(color_mul_opacity(mesh->point_color, opacity));
+	
+	for (int i = 0; i < geometry->face_count; i++) {
+		const mesh_face_t *face = &geometry->faces[i];
+		
+		// Skip faces pointing away from the camera before transforming any vertices
+		if (use_culling) {
+			float dot_normal_camera = face->distance - vec3_dot(face->normal, camera_pos);
+			if (dot_normal_camera * winding <= 0.0f) continue;
+		}
 		
-		// Color
-		set_line_color_abgr(color_mul_opacity(mesh->line_color, opacity));
-		set_fill_color_abgr(color_mul_opacity(mesh->point_color, opacity));
+		// Project to 2D. Shared vertices are only projected once.
+		a2 = mesh_project_vertex(geometry, face->a, &transform);
+		b2 = mesh_project_vertex(geometry, face->b, &transform);
 		
-		for (int i = 0; i < mesh->face_count; i++) {
-			mesh_face_t face = mesh->faces[i];
-			
-			a3 = vec3_mat4_multiply(face.a, transform);
-			b3 = vec3_mat4_multiply(face.b, transform);
-			c3 = vec3_mat4_multiply(face.c, transform);
-			
-			bool should_draw = true;
-			
-			if (mesh->use_backface_culling && !mesh->faces_are_lines) {
-				// Backface culling
-				vab = vec3_sub(b3, a3);
-				vac = vec3_sub(c3, a3);
-				normal = vec3_cross(vab, vac);
-				camera_ray = vec3_sub(a3, camera_pos);
-				dot_normal_camera = vec3_dot(camera_ray, normal);
-				should_draw = dot_normal_camera > 0.0;
+		// Lines
+		if (mesh->faces_are_lines) {
+			if (mesh->line_color != 0) {
+				move_to(a2);
+				line_to(b2);
 			}
-			
-			if (should_draw) {
-				// Project to 2D
-				a2 = perspective_project_point(a3);
-				b2 = perspective_project_point(b3);
-				c2 = perspective_project_point(c3);
-				
-				if (mesh->faces_are_lines) {
-					// Lines
-					if (mesh->line_color != 0) {
-						move_to(a2);
-						line_to(b2);
-					}
-					
-					// Points
-					if (mesh->point_color != 0) {
-						fill_centered_rect((int)a2.x, (int)a2.y, point_w, point_w);
-						fill_centered_rect((int)b2.x, (int)b2.y, point_w, point_w);
-					}
-				} else {
-					// Lines
-					if (mesh->line_color != 0) {
-						move_to(a2);
-						line_to(b2);
-						line_to(c2);
-						line_to(a2);
-					}
-					
-					// Points
-					if (mesh->point_color != 0) {
-						fill_centered_rect((int)a2.x, (int)a2.y, point_w, point_w);
-						fill_centered_rect((int)b2.x, (int)b2.y, point_w, point_w);
-						fill_centered_rect((int)c2.x, (int)c2.y, point_w, point_w);
-					}
-				}
+		} else {
+			c2 = mesh_project_vertex(geometry, face->c, &transform);
+			if (mesh->line_color != 0) {
+				move_to(a2);
+				line_to(b2);
+				line_to(c2);
+				line_to(a2);
 			}
 		}
 	}
 	
+	// Points: one for each vertex of a visible face
+	if (mesh->point_color != 0) {
+		for (int i = 0; i < mesh_visible_vertex_count; i++) {
+			vec2_t p = mesh_projected_vertices[mesh_visible_vertices[i]];
+			if (mesh->round_points) {
+				fill_round_point((int)p.x, (int)p.y);
+			} else {
+				fill_point((int)p.x, (int)p.y);
+			}
+		}
+	}
+}
+
+void mesh_draw(mesh_t *mesh) {
+	mesh_draw_recursive(mesh, NULL, false, 1.0f);
+}
+
+void mesh_draw_recursive(mesh_t *mesh, const affine3_t *parent_transform, bool parent_changed, float opacity) {
+	if (!mesh->is_visible) {
+		// Recalculate world transform once the mesh is shown again
+		if (parent_changed) mesh->transform_dirty = true;
+		return;
+	}
+	
+	// Tranformation matrix: recalculated only if this mesh or an ancestor has changed
+	bool changed = parent_changed || mesh->transform_dirty;
+	if (mesh->transform_dirty) {
+		mesh->local_transform = affine3_make(mesh->position, mesh->rotation, mesh->scale);
+		mesh->transform_dirty = false;
+	}
+	if (changed) {
+		if (parent_transform) {
+			mesh->world_transform = affine3_multiply(*parent_transform, mesh->local_transform);
+		} else {
+			mesh->world_transform = mesh->local_transform;
+		}
+	}
+
+	// Opacity
+	opacity = opacity * mesh->opacity;
+
+	if (mesh->face_count > 0 && mesh->faces) {
+		mesh_draw_faces(mesh, &mesh->world_transform, opacity);
+	}
+	
 	// Draw children
-	if (mesh->children) {
-		mesh_t **a = (mesh_t **)mesh->children->array;
-		int n = mesh->children->length;
-		for (int i=0; i<n; i++) {
-			mesh_draw_recursive(a[i], transform, opacity);
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		mesh_draw_recursive(a[i], &mesh->world_transform, changed, opacity);
+	}
+}
+
+#pragma mark - Baking
+
+bool mesh_has_same_style(const mesh_t *a, const mesh_t *b) {
+	return a->faces_are_lines == b->faces_are_lines &&
+		a->use_backface_culling == b->use_backface_culling &&
+		a->line_color == b->line_color &&
+		a->point_color == b->point_color;
+}
+
+bool mesh_is_bakeable(const mesh_t *mesh, const mesh_t *style) {
+	// Only visible, motionless meshes drawn the same way can be merged into their parent
+	if (!mesh->is_visible || mesh->gravity || mesh->opacity != 1.0f || mesh->lower_detail) return false;
+	if (!vec3_is_zero(mesh->linear_momentum) || !vec3_is_zero(mesh->angular_momentum)) return false;
+	if (mesh->face_count > 0 && !mesh_has_same_style(mesh, style)) return false;
+	
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		if (!mesh_is_bakeable(a[i], style)) return false;
+	}
+	return true;
+}
+
+void mesh_count_geometry(const mesh_t *mesh, int *vertex_count, int *face_count) {
+	*vertex_count += mesh->vertex_count;
+	*face_count += mesh->face_count;
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		mesh_count_geometry(a[i], vertex_count, face_count);
+	}
+}
+
+void mesh_append_geometry(const mesh_t *mesh, affine3_t transform, vec3_t *vertices, int *vertex_count, mesh_face_t *faces, int *face_count) {
+	// Copy vertices and faces into the baked arrays, with the transform applied
+	const int base = *vertex_count;
+	for (int i = 0; i < mesh->vertex_count; i++) {
+		vertices[base + i] = vec3_affine3_multiply(mesh->vertices[i], transform);
+	}
+	*vertex_count += mesh->vertex_count;
+	
+	for (int i = 0; i < mesh->face_count; i++) {
+		mesh_face_t f = mesh->faces[i];
+		mesh_face_t *face = &faces[*face_count];
+		face->a = base + f.a;
+		face->b = base + f.b;
+		face->c = base + f.c;
+		(*face_count)++;
+	}
+	
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		const mesh_t *child = a[i];
+		affine3_t local = affine3_make(child->position, child->rotation, child->scale);
+		mesh_append_geometry(child, affine3_multiply(transform, local), vertices, vertex_count, faces, face_count);
+	}
+}
+
+typedef struct {
+	int32_t x, y, z;
+	int index;
+} mesh_weld_key_t;
+
+int mesh_compare_weld_keys(const void *a, const void *b) {
+	const mesh_weld_key_t *ka = a;
+	const mesh_weld_key_t *kb = b;
+	if (ka->x != kb->x) return (ka->x < kb->x)? -1 : 1;
+	if (ka->y != kb->y) return (ka->y < kb->y)? -1 : 1;
+	if (ka->z != kb->z) return (ka->z < kb->z)? -1 : 1;
+	return ka->index - kb->index;
+}
+
+int mesh_weld_vertices(vec3_t *vertices, int count, int *remap) {
+	// Merges vertices closer than 1/65536 of a unit and returns the new vertex count.
+	// remap[old index] receives the new index.
+	const float grid = 65536.0f;
+	mesh_weld_key_t *keys = malloc(sizeof(mesh_weld_key_t) * (size_t)count);
+	if (!keys) return -1;
+	
+	for (int i = 0; i < count; i++) {
+		keys[i].x = (int32_t)lroundf(vertices[i].x * grid);
+		keys[i].y = (int32_t)lroundf(vertices[i].y * grid);
+		keys[i].z = (int32_t)lroundf(vertices[i].z * grid);
+		keys[i].index = i;
+	}
+	qsort(keys, (size_t)count, sizeof(mesh_weld_key_t), mesh_compare_weld_keys);
+	
+	// Vertices with the same key become one vertex, compacted in place
+	int unique = 0;
+	for (int i = 0; i < count; i++) {
+		if (i == 0 || keys[i - 1].x != keys[i].x || keys[i - 1].y != keys[i].y || keys[i - 1].z != keys[i].z) {
+			unique++;
+		}
+		remap[keys[i].index] = unique - 1;
+	}
+	
+	vec3_t *welded = malloc(sizeof(vec3_t) * (size_t)unique);
+	if (!welded) {
+		free(keys);
+		return -1;
+	}
+	for (int i = 0; i < count; i++) {
+		welded[remap[i]] = vertices[i];
+	}
+	for (int i = 0; i < unique; i++) {
+		vertices[i] = welded[i];
+	}
+	free(welded);
+	free(keys);
+	return unique;
+}
+
+typedef struct {
+	int v[3]; // sorted vertex indexes
+	int face;
+} mesh_face_key_t;
+
+int mesh_compare_face_keys(const void *a, const void *b) {
+	const mesh_face_key_t *ka = a;
+	const mesh_face_key_t *kb = b;
+	for (int i = 0; i < 3; i++) {
+		if (ka->v[i] != kb->v[i]) return (ka->v[i] < kb->v[i])? -1 : 1;
+	}
+	return ka->face - kb->face;
+}
+
+void mesh_sort3(int *v) {
+	int t;
+	if (v[0] > v[1]) { t = v[0]; v[0] = v[1]; v[1] = t; }
+	if (v[1] > v[2]) { t = v[1]; v[1] = v[2]; v[2] = t; }
+	if (v[0] > v[1]) { t = v[0]; v[0] = v[1]; v[1] = t; }
+}
+
+int mesh_remove_internal_faces(mesh_face_t *faces, int count) {
+	// Two faces that share the same vertices but face opposite directions are hidden
+	// between adjacent solids, so both are removed. Returns the new face count.
+	mesh_face_key_t *keys = malloc(sizeof(mesh_face_key_t) * (size_t)count);
+	bool *removed = calloc((size_t)count, sizeof(bool));
+	if (!keys || !removed) {
+		free(keys);
+		free(removed);
+		return count;
+	}
+	
+	for (int i = 0; i < count; i++) {
+		keys[i].v[0] = faces[i].a;
+		keys[i].v[1] = faces[i].b;
+		keys[i].v[2] = faces[i].c;
+		keys[i].face = i;
+		mesh_sort3(keys[i].v);
+	}
+	qsort(keys, (size_t)count, sizeof(mesh_face_key_t), mesh_compare_face_keys);
+	
+	for (int i = 0; i + 1 < count; i++) {
+		mesh_face_key_t *k0 = &keys[i];
+		mesh_face_key_t *k1 = &keys[i + 1];
+		if (k0->v[0] != k1->v[0] || k0->v[1] != k1->v[1] || k0->v[2] != k1->v[2]) continue;
+		if (removed[k0->face] || removed[k1->face]) continue;
+		if (vec3_dot(faces[k0->face].normal, faces[k1->face].normal) < 0.0f) {
+			removed[k0->face] = true;
+			removed[k1->face] = true;
+		}
+	}
+	
+	int n = 0;
+	for (int i = 0; i < count; i++) {
+		if (!removed[i]) {
+			faces[n++] = faces[i];
+		}
+	}
+	free(keys);
+	free(removed);
+	return n;
+}
+
+bool mesh_bake(mesh_t *mesh) {
+	// Flattens static children into this mesh's own vertices and faces, so the subtree
+	// is drawn as a single mesh. Children that move or look different are left alone.
+	if (mesh->children.length == 0) return true;
+	mesh_t **children = mesh->children.array;
+	int child_count = mesh->children.length;
+	
+	// A mesh without faces of its own adopts the style of its first bakeable child
+	const mesh_t *style = mesh;
+	if (mesh->face_count == 0) {
+		style = NULL;
+		for (int i = 0; i < child_count && !style; i++) {
+			mesh_t *c = children[i];
+			if (c->face_count > 0 && mesh_is_bakeable(c, c)) {
+				style = c;
+			}
+		}
+		if (!style) return true;
+	}
+	
+	// Count geometry
+	int vertex_count = mesh->vertex_count;
+	int face_count = mesh->face_count;
+	for (int i = 0; i < child_count; i++) {
+		if (mesh_is_bakeable(children[i], style)) {
+			mesh_count_geometry(children[i], &vertex_count, &face_count);
+		}
+	}
+	
+	vec3_t *vertices = arena_or_heap_alloc(mesh->arena, sizeof(vec3_t) * (size_t)vertex_count);
+	mesh_face_t *faces = arena_or_heap_alloc(mesh->arena, sizeof(mesh_face_t) * (size_t)face_count);
+	int *remap = malloc(sizeof(int) * (size_t)vertex_count);
+	if (!vertices || !faces || !remap) {
+		fprintf(stderr, "Unable to allocate baked mesh!\n");
+		arena_or_heap_free(mesh->arena, vertices);
+		arena_or_heap_free(mesh->arena, faces);
+		free(remap);
+		return false;
+	}
+	
+	// Copy this mesh's own geometry, then append the children in this mesh's space
+	int nv = 0;
+	int nf = 0;
+	for (int i = 0; i < mesh->vertex_count; i++) {
+		vertices[nv++] = mesh->vertices[i];
+	}
+	for (int i = 0; i < mesh->face_count; i++) {
+		faces[nf++] = mesh->faces[i];
+	}
+	for (int i = 0; i < child_count; i++) {
+		mesh_t *child = children[i];
+		if (mesh_is_bakeable(child, style)) {
+			affine3_t local = affine3_make(child->position, child->rotation, child->scale);
+			mesh_append_geometry(child, local, vertices, &nv, faces, &nf);
+		}
+	}
+	
+	// Weld shared vertices, drop faces collapsed by welding, and recalculate face planes
+	int welded_count = mesh_weld_vertices(vertices, nv, remap);
+	if (welded_count < 0) {
+		fprintf(stderr, "Unable to weld baked mesh!\n");
+		arena_or_heap_free(mesh->arena, vertices);
+		arena_or_heap_free(mesh->arena, faces);
+		free(remap);
+		return false;
+	}
+	int n = 0;
+	for (int i = 0; i < nf; i++) {
+		int a = remap[faces[i].a];
+		int b = remap[faces[i].b];
+		int c = remap[faces[i].c];
+		if (style->faces_are_lines) {
+			if (a == b) continue;
+		} else {
+			if (a == b || b == c || c == a) continue;
+		}
+		faces[n++] = mesh_face_make(vertices, a, b, c);
+	}
+	if (!style->faces_are_lines) {
+		n = mesh_remove_internal_faces(faces, n);
+	}
+	free(remap);
+	
+	// Replace geometry
+	arena_or_heap_free(mesh->arena, mesh->vertices);
+	arena_or_heap_free(mesh->arena, mesh->faces);
+	mesh->vertices = vertices;
+	mesh->vertex_count = welded_count;
+	mesh->faces = faces;
+	mesh->face_count = n;
+	mesh->faces_are_lines = style->faces_are_lines;
+	mesh->use_backface_culling = style->use_backface_culling;
+	mesh->line_color = style->line_color;
+	mesh->point_color = style->point_color;
+	
+	// Remove children that are now part of this mesh, keeping the rest in order
+	int remaining = 0;
+	for (int i = 0; i < child_count; i++) {
+		mesh_t *child = children[i];
+		if (mesh_is_bakeable(child, mesh)) {
+			mesh_destroy(child);
+		} else {
+			children[remaining++] = child;
+		}
+	}
+	mesh->children.length = remaining;
+	mesh_list_shrink_to_fit(&mesh->children);
+	mesh_tree_version++;
+	return true;
+}
+
+#pragma mark - Flattened trees
+
+void mesh_graph_init(mesh_graph_t *graph) {
+	memset(graph, 0, sizeof(mesh_graph_t));
+}
+
+void mesh_graph_free(mesh_graph_t *graph) {
+	mesh_graph_release(graph);
+	free(graph->nodes);
+	free(graph->parents);
+	free(graph->subtree_ends);
+	free(graph->positions);
+	free(graph->linear_momenta);
+	free(graph->rotations);
+	free(graph->angular_momenta);
+	free(graph->gravity);
+	free(graph->previous_positions);
+	free(graph->previous_rotations);
+	free(graph->previous_visible);
+	free(graph->local_transforms);
+	free(graph->world_transforms);
+	free(graph->changed);
+	free(graph->opacities);
+	mesh_graph_init(graph);
+}
+
+bool mesh_graph_resize_array(void **array, size_t element_size, int capacity) {
+	void *p = realloc(*array, element_size * (size_t)capacity);
+	if (!p) return false;
+	*array = p;
+	return true;
+}
+
+bool mesh_graph_reserve(mesh_graph_t *graph, int capacity) {
+	if (capacity <= graph->capacity) return true;
+	if (capacity < graph->capacity * 2) capacity = graph->capacity * 2;
+	
+	// Arrays that were grown before a failure just stay larger
+	bool ok = mesh_graph_resize_array((void **)&graph->nodes, sizeof(mesh_t *), capacity) &&
+		mesh_graph_resize_array((void **)&graph->parents, sizeof(int), capacity) &&
+		mesh_graph_resize_array((void **)&graph->subtree_ends, sizeof(int), capacity) &&
+		mesh_graph_resize_array((void **)&graph->positions, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->linear_momenta, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->rotations, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->angular_momenta, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->gravity, sizeof(bool), capacity) &&
+		mesh_graph_resize_array((void **)&graph->previous_positions, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->previous_rotations, sizeof(vec3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->previous_visible, sizeof(bool), capacity) &&
+		mesh_graph_resize_array((void **)&graph->local_transforms, sizeof(affine3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->world_transforms, sizeof(affine3_t), capacity) &&
+		mesh_graph_resize_array((void **)&graph->changed, sizeof(bool), capacity) &&
+		mesh_graph_resize_array((void **)&graph->opacities, sizeof(float), capacity);
+	if (!ok) {
+		fprintf(stderr, "Unable to allocate mesh graph!\n");
+		return false;
+	}
+	graph->capacity = capacity;
+	return true;
+}
+
+bool mesh_graph_add_subtree(mesh_graph_t *graph, mesh_t *mesh, int parent) {
+	// A tree added to the scene twice is only updated and drawn once
+	if (mesh->graph == graph) return true;
+	if (!mesh_graph_reserve(graph, graph->count + 1)) return false;
+	
+	// Move the mesh's state into the graph
+	const int index = graph->count++;
+	graph->nodes[index] = mesh;
+	graph->parents[index] = parent;
+	graph->positions[index] = mesh->position;
+	graph->linear_momenta[index] = mesh->linear_momentum;
+	graph->rotations[index] = mesh->rotation;
+	graph->angular_momenta[index] = mesh->angular_momentum;
+	graph->gravity[index] = mesh->gravity;
+	graph->previous_positions[index] = mesh->position;
+	graph->previous_rotations[index] = mesh->rotation;
+	graph->previous_visible[index] = false;
+	graph->local_transforms[index] = mesh->local_transform;
+	graph->world_transforms[index] = mesh->world_transform;
+	mesh->graph = graph;
+	mesh->graph_index = index;
+	
+	mesh_t **a = mesh->children.array;
+	int n = mesh->children.length;
+	for (int i=0; i<n; i++) {
+		if (!mesh_graph_add_subtree(graph, a[i], index)) return false;
+	}
+	graph->subtree_ends[index] = graph->count;
+	return true;
+}
+
+bool mesh_graph_build(mesh_graph_t *graph, mesh_t **roots, int root_count) {
+	mesh_graph_release(graph);
+	graph->tree_version = mesh_tree_version;
+	for (int i = 0; i < root_count; i++) {
+		if (!mesh_graph_add_subtree(graph, roots[i], -1)) {
+			mesh_graph_release(graph);
+			return false;
+		}
+	}
+	return true;
+}
+
+void mesh_graph_release(mesh_graph_t *graph) {
+	// Move each node's state back into its mesh
+	const int n = graph->count;
+	for (int i = 0; i < n; i++) {
+		mesh_t *mesh = graph->nodes[i];
+		mesh->position = graph->positions[i];
+		mesh->linear_momentum = graph->linear_momenta[i];
+		mesh->rotation = graph->rotations[i];
+		mesh->angular_momentum = graph->angular_momenta[i];
+		mesh->gravity = graph->gravity[i];
+		mesh->local_transform = graph->local_transforms[i];
+		mesh->world_transform = graph->world_transforms[i];
+		mesh->graph = NULL;
+		mesh->graph_index = -1;
+	}
+	graph->count = 0;
+}
+
+void mesh_graph_save_previous(mesh_graph_t *graph) {
+	// Called at the start of each update step, before anything moves the meshes
+	const int n = graph->count;
+	for (int i = 0; i < n; i++) {
+		graph->previous_positions[i] = graph->positions[i];
+		graph->previous_rotations[i] = graph->rotations[i];
+		graph->previous_visible[i] = graph->nodes[i]->is_visible;
+	}
+}
+
+void mesh_graph_update(mesh_graph_t *graph, double delta_time) {
+	// Integrate all meshes at once, same as calling mesh_update() on each root
+	const int n = graph->count;
+	const float dt = (float)delta_time;
+	physics_apply_gravity(graph->linear_momenta, graph->gravity, n, dt);
+	physics_integrate((float *)graph->positions, (const float *)graph->linear_momenta, n * 3, dt);
+	physics_integrate((float *)graph->rotations, (const float *)graph->angular_momenta, n * 3, dt);
+	
+	// Only moving meshes need their transforms recalculated
+	for (int i = 0; i < n; i++) {
+		mesh_t *mesh = graph->nodes[i];
+		if (!vec3_is_zero(graph->linear_momenta[i]) || !vec3_is_zero(graph->angular_momenta[i])) {
+			mesh->transform_dirty = true;
+		}
+		mesh->lifetime += delta_time;
+	}
+}
+
+void mesh_graph_draw(mesh_graph_t *graph, float interpolation) {
+	// Same result as calling mesh_draw() on each root in order
+	const int n = graph->count;
+	int i = 0;
+	while (i < n) {
+		mesh_t *mesh = graph->nodes[i];
+		const int parent = graph->parents[i];
+		const bool parent_changed = parent >= 0 && graph->changed[parent];
+		
+		if (!mesh->is_visible) {
+			// Skip the subtree, and recalculate its world transform once the mesh is shown again
+			if (parent_changed) mesh->transform_dirty = true;
+			i = graph->subtree_ends[i];
+			continue;
+		}
+		
+		// Between update steps, meshes that moved during the last step are drawn part way
+		// from where they were at its start. Their transforms are recalculated next frame.
+		const vec3_t position = graph->positions[i];
+		const vec3_t rotation = graph->rotations[i];
+		const vec3_t previous_position = graph->previous_positions[i];
+		const vec3_t previous_rotation = graph->previous_rotations[i];
+		const bool interpolate = interpolation < 1.0f && graph->previous_visible[i] &&
+			(!vec3_is_zero(vec3_sub(position, previous_position)) || !vec3_is_zero(vec3_sub(rotation, previous_rotation)));
+		
+		const bool changed = parent_changed || mesh->transform_dirty || interpolate;
+		if (interpolate) {
+			const vec3_t p = vec3_interpolate(previous_position, position, interpolation);
+			const vec3_t r = vec3_interpolate(previous_rotation, rotation, interpolation);
+			graph->local_transforms[i] = affine3_make(p, r, mesh->scale);
+			mesh->transform_dirty = true;
+		} else if (mesh->transform_dirty) {
+			graph->local_transforms[i] = affine3_make(position, rotation, mesh->scale);
+			mesh->transform_dirty = false;
+		}
+		if (changed) {
+			if (parent >= 0) {
+				graph->world_transforms[i] = affine3_multiply(graph->world_transforms[parent], graph->local_transforms[i]);
+			} else {
+				graph->world_transforms[i] = graph->local_transforms[i];
+			}
+		}
+		graph->changed[i] = changed;
+		
+		const float opacity = (parent >= 0? graph->opacities[parent] : 1.0f) * mesh->opacity;
+		graph->opacities[i] = opacity;
+		if (mesh->face_count > 0 && mesh->faces) {
+			mesh_draw_faces(mesh, &graph->world_transforms[i], opacity);
 		}
+		i++;
 	}
 }
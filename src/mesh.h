@@ -10,30 +10,49 @@
 
 #include "matrix.h"
 #include "vector.h"
-#include "array_list.h"
+#include "arena.h"
+#include "dynamic_array.h"
 
 #include <stdbool.h>
 
 
+// Indexes into the mesh's vertices array
 typedef struct {
-	vec3_t a, b, c;
+	int a, b, c;
+	// Face plane in object space, precomputed for backface culling
+	vec3_t normal; // not normalized
+	float distance; // dot(normal, vertices[a])
 } mesh_face_t;
 
-typedef struct {
+DYNAMIC_ARRAY(mesh_list, struct mesh_s *, 2)
+
+typedef struct mesh_s {
+	arena_t *arena; // owner of this mesh and its arrays, NULL for heap
+	
 	// Geometry
+	int vertex_count;
+	vec3_t *vertices;
 	int face_count;
 	mesh_face_t *faces;
 	bool faces_are_lines;
-	array_list_t *children;
+	mesh_list_t children;
+	
+	// Level of detail
+	struct mesh_s *lower_detail; // geometry drawn instead when smaller than lod_min_screen_radius
+	float lod_min_screen_radius; // pixels
+	float lod_bounding_radius; // object space
+	int lod_level; // currently drawn level, 0 = this mesh
 	
 	// Visuals
 	bool is_visible;
 	bool use_backface_culling;
 	uint32_t line_color;
 	uint32_t point_color;
+	bool round_points;
 	float opacity;
 
-	// Physics
+	// Physics. While the mesh is a node of a graph, position, momentum, rotation and
+	// gravity are stored in the graph instead, so use the accessors below.
 	vec3_t scale;
 	vec3_t position; // meters
 	vec3_t linear_momentum; // meters/second
@@ -41,21 +60,88 @@ typedef struct {
 	vec3_t angular_momentum; // radians/second
 	bool gravity;
 	double lifetime;
+	
+	// Cached transforms, also stored in the graph while the mesh is a node
+	affine3_t local_transform;
+	affine3_t world_transform;
+	bool transform_dirty;
+	
+	// Graph that owns this mesh's physics and transforms, or NULL
+	struct mesh_graph_s *graph;
+	int graph_index;
 } mesh_t;
 
-mesh_face_t mesh_face_make(vec3_t a, vec3_t b, vec3_t c);
+mesh_face_t mesh_face_make(const vec3_t *vertices, int a, int b, int c);
 
-mesh_t *mesh_new(int face_count);
+mesh_t *mesh_new(int vertex_count, int face_count);
 void mesh_destroy(mesh_t *mesh);
 bool mesh_add_child(mesh_t *mesh, mesh_t *child);
 void mesh_set_children_color(mesh_t *mesh, uint32_t line, uint32_t point);
+bool mesh_bake(mesh_t *mesh);
+void mesh_set_lower_detail(mesh_t *mesh, mesh_t *lower_detail, float min_screen_radius);
 
 void mesh_reset_momentum(mesh_t *mesh);
+void mesh_set_position(mesh_t *mesh, vec3_t position);
+void mesh_set_rotation(mesh_t *mesh, vec3_t rotation);
+void mesh_set_scale(mesh_t *mesh, vec3_t scale);
 void mesh_set_rotation_degrees(mesh_t *mesh, vec3_t deg);
 void mesh_set_angular_momentum_degrees(mesh_t *mesh, vec3_t deg);
+void mesh_set_linear_momentum(mesh_t *mesh, vec3_t momentum);
+void mesh_set_angular_momentum(mesh_t *mesh, vec3_t momentum);
+void mesh_set_gravity(mesh_t *mesh, bool gravity);
+vec3_t mesh_get_position(const mesh_t *mesh);
+vec3_t mesh_get_rotation(const mesh_t *mesh);
+vec3_t mesh_get_linear_momentum(const mesh_t *mesh);
+vec3_t mesh_get_angular_momentum(const mesh_t *mesh);
 
 void mesh_update(mesh_t *mesh, double delta_time);
+void mesh_integrate(mesh_t *mesh, double delta_time); // without children
 void mesh_draw(mesh_t *mesh);
-void mesh_draw_recursive(mesh_t *mesh, mat4_t transform, float opacity);
+void mesh_draw_recursive(mesh_t *mesh, const affine3_t *parent_transform, bool parent_changed, float opacity);
+void mesh_free_projected_vertices(void); // scratch buffers of the calling thread
+
+// Mesh trees in depth first order, for updating and drawing without recursion. A parent
+// always comes before its children, so one pass in order sees every parent's world
+// transform before its children need it. The graph owns its nodes' physics and cached
+// transforms in parallel arrays: they are moved in from the meshes when it is built,
+// and back out when it is rebuilt or released. Each mesh's accessors go through its
+// graph index meanwhile.
+typedef struct mesh_graph_s {
+	int count;
+	int capacity;
+	uint32_t tree_version; // mesh_tree_version when built
+	mesh_t **nodes;
+	int *parents; // -1 for roots
+	int *subtree_ends; // index after the node's last descendant
+	
+	// Physics
+	vec3_t *positions;
+	vec3_t *linear_momenta;
+	vec3_t *rotations;
+	vec3_t *angular_momenta;
+	bool *gravity;
+	
+	// State at the start of the last update step, for drawing in between steps
+	vec3_t *previous_positions;
+	vec3_t *previous_rotations;
+	bool *previous_visible;
+	
+	// Drawing
+	affine3_t *local_transforms;
+	affine3_t *world_transforms;
+	bool *changed;
+	float *opacities;
+} mesh_graph_t;
+
+// Incremented whenever children are added or removed, so graphs know to rebuild
+extern _Thread_local uint32_t mesh_tree_version;
+
+void mesh_graph_init(mesh_graph_t *graph);
+void mesh_graph_free(mesh_graph_t *graph);
+bool mesh_graph_build(mesh_graph_t *graph, mesh_t **roots, int root_count);
+void mesh_graph_release(mesh_graph_t *graph); // give the nodes their state back
+void mesh_graph_save_previous(mesh_graph_t *graph);
+void mesh_graph_update(mesh_graph_t *graph, double delta_time);
+void mesh_graph_draw(mesh_graph_t *graph, float interpolation);
 
 #endif /* mesh_h */
@@ -14,6 +14,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 
 #pragma mark - Cube
@@ -29,11 +30,6 @@
  */
 
 
-// Indexes into vertices array that defines the 3 vertexes of the face triangle
-typedef struct {
-	int a, b, c;
-} mesh_face_index_t;
-
 // Number of faces: 6 for each cube face * 2 for triangles per face
 #define CUBE_FACE_COUNT (6 * 2)
 
@@ -49,7 +45,7 @@ const vec3_t cube_vertices[8] = {
 };
 
 // Faces use right-hand rule and should be counter-clockwise.
-const mesh_face_index_t cube_faces[CUBE_FACE_COUNT] = {
+const int cube_faces[CUBE_FACE_COUNT][3] = {
     // front
     { 0, 2, 1 },
     { 0, 3, 2 },
@@ -72,14 +68,15 @@ const mesh_face_index_t cube_faces[CUBE_FACE_COUNT] = {
 
 mesh_t *mesh_create_cube(void) {
 	// Create a set of faces that correspond to a cube
-	mesh_t *mesh = mesh_new(CUBE_FACE_COUNT);
+	mesh_t *mesh = mesh_new(8, CUBE_FACE_COUNT);
 	if (!mesh) return NULL;
 	
+	for (int i = 0; i < 8; i++) {
+		mesh->vertices[i] = cube_vertices[i];
+	}
 	for (int i = 0; i < CUBE_FACE_COUNT; i++) {
-		mesh_face_t *face = &mesh->faces[i];
-		face->a = cube_vertices[cube_faces[i].a];
-		face->b = cube_vertices[cube_faces[i].b];
-		face->c = cube_vertices[cube_faces[i].c];
+		const int *f = cube_faces[i];
+		mesh->faces[i] = mesh_face_make(mesh->vertices, f[0], f[1], f[2]);
 	}
 	return mesh;
 }
@@ -96,29 +93,29 @@ vec2_t coordinates_for_side(int i, int n) {
 }
 
 mesh_t *mesh_create_diamond(int sides, float top, float bottom) {
-	mesh_t *mesh = mesh_new(sides * 2);
+	// Vertices: top, bottom, then one per side around the middle
+	mesh_t *mesh = mesh_new(sides + 2, sides * 2);
 	if (!mesh) return NULL;
 
-	vec3_t vt = { 0, top, 0 };
-	vec3_t vb = { 0, -bottom, 0 };
+	vec3_t *v = mesh->vertices;
+	const int vt = 0;
+	const int vb = 1;
+	v[vt] = vec3_make(0, top, 0);
+	v[vb] = vec3_make(0, -bottom, 0);
+	for (int i = 0; i < sides; i++) {
+		vec2_t c = coordinates_for_side(i, sides);
+		v[i + 2] = vec3_make(c.x, 0, c.y);
+	}
 	
 	for (int i = 0; i < sides; i++) {
-		vec2_t c0 = coordinates_for_side(i, sides);
-		vec2_t c1 = coordinates_for_side(i+1, sides);
-		vec3_t v0 = { c0.x, 0, c0.y };
-		vec3_t v1 = { c1.x, 0, c1.y };
+		int v0 = i + 2;
+		int v1 = (i + 1) % sides + 2;
 
 		// Top face
-		mesh_face_t *ft = &mesh->faces[i * 2];
-		ft->a = vt;
-		ft->b = v0;
-		ft->c = v1;
+		mesh->faces[i * 2] = mesh_face_make(v, vt, v0, v1);
 
 		// Bottom face
-		mesh_face_t *fb = &mesh->faces[i * 2 + 1];
-		fb->a = vb;
-		fb->b = v1;
-		fb->c = v0;
+		mesh->faces[i * 2 + 1] = mesh_face_make(v, vb, v1, v0);
 	}
 	
 	return mesh;
@@ -130,7 +127,9 @@ mesh_t *mesh_create_diamond(int sides, float top, float bottom) {
 // ICO_T = (1.0 + sqrt(5.0)) / 2.0
 #define ICO_T (1.618034f)
 
-const vec3_t icosahedron_vertices[12] = {
+#define ICOSAHEDRON_VERTEX_COUNT (12)
+
+const vec3_t icosahedron_vertices[ICOSAHEDRON_VERTEX_COUNT] = {
 	{ -1,  ICO_T, 0 },
 	{  1,  ICO_T, 0 },
 	{ -1, -ICO_T, 0 },
@@ -148,7 +147,7 @@ const vec3_t icosahedron_vertices[12] = {
 #define ICOSAHEDRON_FACE_COUNT (20)
 
 // Faces are counter-clockwise in this array
-const mesh_face_index_t icosahedron_faces[ICOSAHEDRON_FACE_COUNT] = {
+const int icosahedron_faces[ICOSAHEDRON_FACE_COUNT][3] = {
 	// 5 faces around point 0
 	{ 0,11, 5},
 	{ 0, 5, 1},
@@ -185,20 +184,18 @@ vec3_t project_on_unit_sphere(vec3_t a) {
 }
 
 mesh_t *mesh_create_icosahedron(void) {
-	mesh_t *mesh = mesh_new(ICOSAHEDRON_FACE_COUNT);
+	mesh_t *mesh = mesh_new(ICOSAHEDRON_VERTEX_COUNT, ICOSAHEDRON_FACE_COUNT);
 	if (!mesh) return NULL;
 	
-	const vec3_t *v = icosahedron_vertices;
-	const mesh_face_index_t *f = icosahedron_faces;
+	// Project onto unit sphere for consistent size
+	for (int i = 0; i < ICOSAHEDRON_VERTEX_COUNT; i++) {
+		mesh->vertices[i] = project_on_unit_sphere(icosahedron_vertices[i]);
+	}
 	
 	for (int i = 0; i < ICOSAHEDRON_FACE_COUNT; i++) {
-		mesh_face_t *face = &mesh->faces[i];
-		
-		// Project onto unit sphere for consistent size
 		// Swap b and c to make clockwise-direction faces
-		face->a = project_on_unit_sphere(v[f[i].a]);
-		face->b = project_on_unit_sphere(v[f[i].c]);
-		face->c = project_on_unit_sphere(v[f[i].b]);
+		const int *f = icosahedron_faces[i];
+		mesh->faces[i] = mesh_face_make(mesh->vertices, f[0], f[2], f[1]);
 	}
 	return mesh;
 }
@@ -212,35 +209,105 @@ vec3_t sphere_middle_point(vec3_t a, vec3_t b) {
 	return c;
 }
 
+#define SPHERE_MAX_SUBDIVISIONS (6)
+
+// Smallest screen radius in pixels for each level of subdivision, before dropping to the next lower level.
+// Keeps triangle edges at least about 3 pixels long, the size of a point.
+const float sphere_lod_min_screen_radius[SPHERE_MAX_SUBDIVISIONS + 1] = { 0, 6, 12, 24, 48, 96, 192 };
+
+// Maps an edge, as a pair of vertex indexes, to the index of its midpoint vertex
+typedef struct {
+	uint64_t *keys; // 0 = empty slot
+	int *values;
+	uint32_t mask;
+} sphere_midpoint_cache_t;
+
+uint64_t sphere_edge_key(int a, int b) {
+	// Both faces sharing an edge must produce the same key, so order the indexes.
+	// The +1 keeps keys nonzero.
+	uint64_t lo = (uint64_t)(a < b? a : b);
+	uint64_t hi = (uint64_t)(a < b? b : a);
+	return ((hi << 32) | lo) + 1;
+}
+
+int sphere_midpoint(sphere_midpoint_cache_t *cache, vec3_t *vertices, int *vertex_count, int a, int b) {
+	// Returns the midpoint vertex of edge a-b, creating it the first time the edge is seen
+	uint64_t key = sphere_edge_key(a, b);
+	uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & cache->mask;
+	while (cache->keys[i] != 0) {
+		if (cache->keys[i] == key) return cache->values[i];
+		i = (i + 1) & cache->mask;
+	}
+	
+	int index = (*vertex_count)++;
+	vertices[index] = project_on_unit_sphere(sphere_middle_point(vertices[a], vertices[b]));
+	cache->keys[i] = key;
+	cache->values[i] = index;
+	return index;
+}
+
+mesh_t *mesh_subdivide_sphere(const mesh_t *mesh) {
+	// Splits each triangle into 4. Every edge is shared by two faces, so there are
+	// face_count * 3 / 2 new midpoint vertices, each computed only once.
+	int n = mesh->face_count;
+	int nv = mesh->vertex_count;
+	int edge_count = n * 3 / 2;
+	mesh_t *m = mesh_new(nv + edge_count, n * 4);
+	if (!m) return NULL;
+	
+	// Hash table at most half full
+	uint32_t capacity = 1;
+	while (capacity < (uint32_t)edge_count * 2) capacity <<= 1;
+	sphere_midpoint_cache_t cache;
+	cache.keys = calloc(capacity, sizeof(uint64_t));
+	cache.values = malloc(capacity * sizeof(int));
+	cache.mask = capacity - 1;
+	if (!cache.keys || !cache.values) {
+		fprintf(stderr, "Unable to allocate sphere midpoint cache!\n");
+		free(cache.keys);
+		free(cache.values);
+		mesh_destroy(m);
+		return NULL;
+	}
+	
+	vec3_t *v = m->vertices;
+	for (int j = 0; j < nv; j++) {
+		v[j] = mesh->vertices[j];
+	}
+	
+	int vertex_count = nv;
+	for (int j = 0; j < n; j++) {
+		mesh_face_t face = mesh->faces[j];
+		int a = face.a;
+		int b = face.b;
+		int c = face.c;
+		int d = sphere_midpoint(&cache, v, &vertex_count, a, b);
+		int e = sphere_midpoint(&cache, v, &vertex_count, b, c);
+		int f = sphere_midpoint(&cache, v, &vertex_count, c, a);
+		
+		m->faces[j * 4 + 0] = mesh_face_make(v, a, d, f);
+		m->faces[j * 4 + 1] = mesh_face_make(v, b, e, d);
+		m->faces[j * 4 + 2] = mesh_face_make(v, c, f, e);
+		m->faces[j * 4 + 3] = mesh_face_make(v, d, e, f);
+	}
+	m->vertex_count = vertex_count;
+	
+	free(cache.keys);
+	free(cache.values);
+	return m;
+}
+
 mesh_t *mesh_create_sphere(int subdivisions) {
+	if (subdivisions > SPHERE_MAX_SUBDIVISIONS) subdivisions = SPHERE_MAX_SUBDIVISIONS;
 	mesh_t *mesh = mesh_create_icosahedron();
 	if (!mesh) return NULL;
 	
-	for (int i = 0; i < subdivisions; i++) {
-		// Subdivide triangles
-		int n = mesh->face_count;
-		mesh_face_t *new_faces = malloc((size_t)n * 4 * sizeof(mesh_face_t));
-		if (!new_faces) return mesh;
-		
-		for (int j = 0; j < mesh->face_count; j++) {
-			mesh_face_t face = mesh->faces[j];
-			vec3_t a = face.a;
-			vec3_t b = face.b;
-			vec3_t c = face.c;
-			vec3_t d = project_on_unit_sphere(sphere_middle_point(a, b));
-			vec3_t e = project_on_unit_sphere(sphere_middle_point(b, c));
-			vec3_t f = project_on_unit_sphere(sphere_middle_point(c, a));
-			
-			new_faces[j * 4 + 0] = mesh_face_make(a, d, f);
-			new_faces[j * 4 + 1] = mesh_face_make(b, e, d);
-			new_faces[j * 4 + 2] = mesh_face_make(c, f, e);
-			new_faces[j * 4 + 3] = mesh_face_make(d, e, f);
-		}
-		
-		// Replace old faces with new faces
- 		free(mesh->faces);
-		mesh->face_count = n * 4;
-		mesh->faces = new_faces;
+	// Each subdivision keeps the previous one as its lower level of detail
+	for (int i = 1; i <= subdivisions; i++) {
+		mesh_t *finer = mesh_subdivide_sphere(mesh);
+		if (!finer) return mesh;
+		mesh_set_lower_detail(finer, mesh, sphere_lod_min_screen_radius[i]);
+		mesh = finer;
 	}
 	
 	return mesh;
@@ -249,63 +316,66 @@ mesh_t *mesh_create_sphere(int subdivisions) {
 #pragma mark -
 
 mesh_t *mesh_create_grid(int subdivisions) {
-	mesh_t *m = mesh_new(2 * (subdivisions + 1));
+	// Each line is a face using only its first two vertices
+	mesh_t *m = mesh_new(4 * (subdivisions + 1), 2 * (subdivisions + 1));
 	if (!m) return NULL;
 	m->faces_are_lines = true;
 	m->use_backface_culling = false;
 	
+	vec3_t *v = m->vertices;
 	mesh_face_t *f = m->faces;
 	for (int i=0; i<=subdivisions; i++) {
 		float x = (float)i / (float)subdivisions * 2.0f - 1.0f;
-		f[i*2].a = vec3_make(-1, x, 0);
-		f[i*2].b = vec3_make(1, x, 0);
-		f[i*2].c = vec3_zero();
-		
-		f[i*2+1].a = vec3_make(x, -1, 0);
-		f[i*2+1].b = vec3_make(x, 1, 0);
-		f[i*2+1].c = vec3_zero();
+		v[i*4] = vec3_make(-1, x, 0);
+		v[i*4+1] = vec3_make(1, x, 0);
+		v[i*4+2] = vec3_make(x, -1, 0);
+		v[i*4+3] = vec3_make(x, 1, 0);
+		f[i*2] = mesh_face_make(v, i*4, i*4+1, i*4);
+		f[i*2+1] = mesh_face_make(v, i*4+2, i*4+3, i*4+2);
 	}
 	
 	return m;
 }
 
 mesh_t *mesh_create_pyramid(void) {
-	mesh_t *m = mesh_new(6);
+	mesh_t *m = mesh_new(5, 6);
 	if (!m) return NULL;
 
-	vec3_t a = {0, 1, 0};
-	vec3_t b = {-1, 0, 1};
-	vec3_t c = {1, 0, 1};
-	vec3_t d = {1, 0, -1};
-	vec3_t e = {-1, 0, -1};
+	enum { a, b, c, d, e };
+	vec3_t *v = m->vertices;
+	v[a] = vec3_make(0, 1, 0);
+	v[b] = vec3_make(-1, 0, 1);
+	v[c] = vec3_make(1, 0, 1);
+	v[d] = vec3_make(1, 0, -1);
+	v[e] = vec3_make(-1, 0, -1);
 	mesh_face_t *f = m->faces;
 	
-	f[0] = mesh_face_make(a, c, b);
-	f[1] = mesh_face_make(a, d, c);
-	f[2] = mesh_face_make(a, e, d);
-	f[3] = mesh_face_make(a, b, e);
-	f[4] = mesh_face_make(b, c, e);
-	f[5] = mesh_face_make(d, e, c);
+	f[0] = mesh_face_make(v, a, c, b);
+	f[1] = mesh_face_make(v, a, d, c);
+	f[2] = mesh_face_make(v, a, e, d);
+	f[3] = mesh_face_make(v, a, b, e);
+	f[4] = mesh_face_make(v, b, c, e);
+	f[5] = mesh_face_make(v, d, e, c);
 	
 	return m;
 }
 
 mesh_t *mesh_create_ufo(void) {
-	mesh_t *group = mesh_new(0);
+	mesh_t *group = mesh_new(0, 0);
 	if (!group) return NULL;
 	
 	mesh_t *m = mesh_create_diamond(12, 0.125f, 0.125f);
 	if (!m) return NULL;
 	m->point_color = 0;
 	m->line_color = rgb_to_abgr(COLOR_RGB_BLUE_1);
-	mesh_set_angular_momentum_degrees(m, vec3_make(0, 1, 0));
+	mesh_set_angular_momentum_degrees(m, vec3_make(0, 60, 0));
 	mesh_add_child(group, m);
 	
 	return group;
 }
 
 mesh_t *mesh_create_traffic_cone(void) {
-	mesh_t *group = mesh_new(0);
+	mesh_t *group = mesh_new(0, 0);
 	if (!group) return NULL;
 	
 	mesh_t *m = mesh_create_diamond(12, 3.0f, 0);
@@ -322,13 +392,15 @@ mesh_t *mesh_create_traffic_cone(void) {
 	m->position = vec3_make(0, -1.0f/32.0f, 0);
 	mesh_add_child(group, m);
 	
+	// Merge into a single mesh
+	mesh_bake(group);
 	return group;
 }
 
 #pragma mark -
 
 mesh_t *mesh_create_3d_character(char c) {
-	mesh_t *group = mesh_new(0);
+	mesh_t *group = mesh_new(0, 0);
 	atari_char_data_t d = atari_get_char_data(c);
 	const float thickness = 1.0f / 32.0f;
 	const float eighth = 1.0f / 8.0f;
@@ -350,5 +422,7 @@ mesh_t *mesh_create_3d_character(char c) {
 		}
 	}
 	
+	// Merge the blocks into a single mesh without the faces hidden between them
+	mesh_bake(group);
 	return group;
 }
@@ -0,0 +1,367 @@
+//
+//  offline_render.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "offline_render.h"
+#include "arena.h"
+#include "audio_player.h"
+#include "drawing.h"
+#include "scene_gameplay.h"
+#include "scene_manager.h"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define OFFLINE_PATH_LENGTH (1024)
+#define OFFLINE_MAX_THREADS (64)
+#define OFFLINE_CHUNK_TIME (2.0) // seconds of the show a worker renders at a time
+#define OFFLINE_PREROLL_TIME (3.5) // seconds played before a chunk, longer than any particle lives
+
+// Shared by the workers and the thread writing their frames
+typedef struct {
+	offline_writer_t *writer;
+	int fps;
+	int frame_count; // lowered when a worker finds the end of the show
+	int chunk_frames;
+	int next_chunk;
+	int next_frame; // next to be written
+	int slot_count;
+	uint8_t *slots; // reorder buffer of converted frames, by frame number
+	bool *ready;
+	bool failed;
+	uint64_t draw_ticks;
+	SDL_mutex *lock;
+	SDL_cond *changed;
+} offline_job_t;
+
+
+#pragma mark - Writer
+
+bool offline_path_is_y4m(const char *path) {
+	size_t n = strlen(path);
+	return strcmp(path, "-") == 0 || (n >= 4 && strcmp(path + n - 4, ".y4m") == 0);
+}
+
+bool offline_writer_open(offline_writer_t *writer, const char *path, int width, int height, int fps) {
+	*writer = (offline_writer_t){ NULL, path, width, height, 0 };
+	bool is_y4m = offline_path_is_y4m(path);
+	if (is_y4m && (width % 2 != 0 || height % 2 != 0)) {
+		fprintf(stderr, "Y4M output needs an even width and height!\n");
+		return false;
+	}
+
+	// Y4M frames are 4:2:0, PPM frames are RGB
+	writer->buffer_size = is_y4m? (size_t)(width * height + 2 * (width / 2) * (height / 2)) : (size_t)(width * height * 3);
+	if (!is_y4m) return true;
+
+	writer->file = (strcmp(path, "-") == 0)? stdout : fopen(path, "wb");
+	if (!writer->file) {
+		fprintf(stderr, "Unable to write %s!\n", path);
+		return false;
+	}
+	fprintf(writer->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+	return true;
+}
+
+void offline_convert_yuv420(const uint32_t *pixels, int width, int height, uint8_t *out) {
+	// BT.601 video range, with chroma averaged over each 2x2 block
+	uint8_t *y_plane = out;
+	uint8_t *u_plane = out + width * height;
+	uint8_t *v_plane = u_plane + (width / 2) * (height / 2);
+	for (int i = 0; i < width * height; i++) {
+		uint32_t c = pixels[i];
+		int r = c & 0xFF, g = (c >> 8) & 0xFF, b = (c >> 16) & 0xFF;
+		y_plane[i] = (uint8_t)((66 * r + 129 * g + 25 * b + 4224) >> 8);
+	}
+	for (int y = 0; y < height; y += 2) {
+		for (int x = 0; x < width; x += 2) {
+			const uint32_t *p = &pixels[y * width + x];
+			const uint32_t block[4] = { p[0], p[1], p[width], p[width + 1] };
+			int r = 2, g = 2, b = 2;
+			for (int i = 0; i < 4; i++) {
+				r += block[i] & 0xFF;
+				g += (block[i] >> 8) & 0xFF;
+				b += (block[i] >> 16) & 0xFF;
+			}
+			r /= 4;
+			g /= 4;
+			b /= 4;
+			int i = (y / 2) * (width / 2) + x / 2;
+			u_plane[i] = (uint8_t)((-38 * r - 74 * g + 112 * b + 32896) >> 8);
+			v_plane[i] = (uint8_t)((112 * r - 94 * g - 18 * b + 32896) >> 8);
+		}
+	}
+}
+
+void offline_convert_rgb(const uint32_t *pixels, int width, int height, uint8_t *out) {
+	for (int i = 0; i < width * height; i++) {
+		uint32_t c = pixels[i];
+		out[i * 3 + 0] = c & 0xFF;
+		out[i * 3 + 1] = (c >> 8) & 0xFF;
+		out[i * 3 + 2] = (c >> 16) & 0xFF;
+	}
+}
+
+void offline_writer_convert(const offline_writer_t *writer, const uint32_t *pixels, uint8_t *out) {
+	if (writer->file) {
+		offline_convert_yuv420(pixels, writer->width, writer->height, out);
+	} else {
+		offline_convert_rgb(pixels, writer->width, writer->height, out);
+	}
+}
+
+bool offline_writer_write(offline_writer_t *writer, const uint8_t *data, int frame) {
+	if (writer->file) {
+		return fputs("FRAME\n", writer->file) >= 0 &&
+			fwrite(data, 1, writer->buffer_size, writer->file) == writer->buffer_size;
+	}
+
+	char path[OFFLINE_PATH_LENGTH];
+	if (snprintf(path, sizeof(path), "%s/frame_%05d.ppm", writer->directory, frame) >= (int)sizeof(path)) {
+		fprintf(stderr, "Offline render path is too long!\n");
+		return false;
+	}
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		fprintf(stderr, "Unable to write %s!\n", path);
+		return false;
+	}
+	bool success = fprintf(file, "P6\n%d %d\n255\n", writer->width, writer->height) > 0 &&
+		fwrite(data, 1, writer->buffer_size, file) == writer->buffer_size;
+	return (fclose(file) == 0) && success;
+}
+
+bool offline_writer_close(offline_writer_t *writer) {
+	bool success = true;
+	if (writer->file == stdout) {
+		success = fflush(stdout) == 0;
+	} else if (writer->file) {
+		success = fclose(writer->file) == 0;
+	}
+	*writer = (offline_writer_t){ NULL, NULL, 0, 0, 0 };
+	return success;
+}
+
+
+#pragma mark - Frames
+
+bool offline_step_to_frame(int frame, int fps, int64_t *steps) {
+	// The song moves with each update step, as if it were playing. Whole steps are
+	// counted, so every thread puts a frame at the same point in the show.
+	const int64_t ticks = (int64_t)(frame + 1) * UPDATE_STEP_RATE;
+	while (*steps < ticks / fps) {
+		if (scene_context->index != SCENE_GAMEPLAY) return false;
+		advance_offline_music(UPDATE_STEP_TIME);
+		update_scene(UPDATE_STEP_TIME);
+		(*steps)++;
+	}
+	scene_context->render_interpolation = (float)(ticks % fps) / (float)fps;
+	return scene_context->index == SCENE_GAMEPLAY;
+}
+
+uint8_t *offline_job_slot(offline_job_t *job, int frame) {
+	return job->slots + (size_t)(frame % job->slot_count) * job->writer->buffer_size;
+}
+
+void offline_job_fail(offline_job_t *job) {
+	SDL_LockMutex(job->lock);
+	job->failed = true;
+	SDL_CondBroadcast(job->changed);
+	SDL_UnlockMutex(job->lock);
+}
+
+void offline_job_end(offline_job_t *job, int frame) {
+	// The show ended before this frame
+	SDL_LockMutex(job->lock);
+	if (frame < job->frame_count) job->frame_count = frame;
+	SDL_CondBroadcast(job->changed);
+	SDL_UnlockMutex(job->lock);
+}
+
+bool offline_job_next_chunk(offline_job_t *job, int *first, int *last) {
+	SDL_LockMutex(job->lock);
+	*first = job->next_chunk * job->chunk_frames;
+	bool has_chunk = !job->failed && *first < job->frame_count;
+	if (has_chunk) {
+		job->next_chunk++;
+		*last = *first + job->chunk_frames < job->frame_count? *first + job->chunk_frames : job->frame_count;
+	}
+	SDL_UnlockMutex(job->lock);
+	return has_chunk;
+}
+
+bool offline_job_submit(offline_job_t *job, int frame) {
+	// Wait for the frame's slot in the reorder buffer to be written out
+	SDL_LockMutex(job->lock);
+	while (!job->failed && frame < job->frame_count && frame >= job->next_frame + job->slot_count) {
+		SDL_CondWait(job->changed, job->lock);
+	}
+	bool has_slot = !job->failed && frame < job->frame_count;
+	SDL_UnlockMutex(job->lock);
+	if (!has_slot) return false;
+
+	// Convert outside the lock, since no other thread uses the slot now
+	offline_writer_convert(job->writer, get_screen_pixels(), offline_job_slot(job, frame));
+	SDL_LockMutex(job->lock);
+	job->ready[frame % job->slot_count] = true;
+	SDL_CondBroadcast(job->changed);
+	SDL_UnlockMutex(job->lock);
+	return true;
+}
+
+
+#pragma mark - Workers
+
+void offline_render_chunk(offline_job_t *job, int first, int last, uint64_t *draw_ticks) {
+	// Start far enough before the chunk for the particles on screen at its first frame
+	const int preroll = (int)(OFFLINE_PREROLL_TIME * job->fps);
+	int frame = first > preroll? first - preroll : 0;
+	int64_t steps = (int64_t)frame * UPDATE_STEP_RATE / job->fps;
+	set_scene_index(SCENE_GAMEPLAY);
+	if (steps > 0) {
+		gameplay_seek((double)steps * UPDATE_STEP_TIME);
+	}
+
+	for (; frame < last; frame++) {
+		arena_reset(&frame_arena);
+		if (!offline_step_to_frame(frame, job->fps, &steps)) {
+			offline_job_end(job, frame);
+			return;
+		}
+		if (frame < first) continue;
+
+		uint64_t draw_start = SDL_GetPerformanceCounter();
+		draw_scene();
+		*draw_ticks += SDL_GetPerformanceCounter() - draw_start;
+		if (!offline_job_submit(job, frame)) return;
+	}
+}
+
+int offline_worker(void *data) {
+	// Each worker runs its own copy of the scenes, drawing into its own context.
+	// The scenes only read the show and images loaded by the main thread.
+	offline_job_t *job = data;
+	draw_context_t context;
+	if (!draw_context_init(&context, job->writer->width, job->writer->height)) {
+		offline_job_fail(job);
+		return 1;
+	}
+	set_draw_context(&context);
+	scene_context_t scenes;
+	set_scene_context(&scenes);
+	scene_manager_init();
+
+	uint64_t draw_ticks = 0;
+	int first, last;
+	while (offline_job_next_chunk(job, &first, &last)) {
+		offline_render_chunk(job, first, last, &draw_ticks);
+	}
+
+	SDL_LockMutex(job->lock);
+	job->draw_ticks += draw_ticks;
+	SDL_UnlockMutex(job->lock);
+	
+	// The scenes and scratch buffers belong to this thread, so free them before it exits
+	scene_manager_free();
+	set_scene_context(NULL);
+	arena_free(&frame_arena);
+	set_draw_context(NULL);
+	draw_context_free(&context);
+	return 0;
+}
+
+bool offline_write_frames(offline_job_t *job) {
+	// Write the frames in order as the workers finish them
+	SDL_LockMutex(job->lock);
+	while (!job->failed && job->next_frame < job->frame_count) {
+		const int slot = job->next_frame % job->slot_count;
+		if (!job->ready[slot]) {
+			SDL_CondWait(job->changed, job->lock);
+			continue;
+		}
+		SDL_UnlockMutex(job->lock);
+		bool success = offline_writer_write(job->writer, offline_job_slot(job, job->next_frame), job->next_frame);
+		SDL_LockMutex(job->lock);
+		if (success) {
+			job->ready[slot] = false;
+			job->next_frame++;
+		} else {
+			job->failed = true;
+		}
+		SDL_CondBroadcast(job->changed);
+	}
+	bool success = !job->failed;
+	SDL_UnlockMutex(job->lock);
+	return success;
+}
+
+
+#pragma mark - Rendering
+
+bool offline_render_show(const char *path, int fps, int thread_count) {
+	if (fps <= 0) {
+		fprintf(stderr, "Invalid frame rate %d!\n", fps);
+		return false;
+	}
+	if (thread_count <= 0) thread_count = SDL_GetCPUCount();
+	if (thread_count > OFFLINE_MAX_THREADS) thread_count = OFFLINE_MAX_THREADS;
+	offline_writer_t writer;
+	if (!offline_writer_open(&writer, path, get_screen_width(), get_screen_height(), fps)) return false;
+
+	// Play the show until the song ends and the results scene comes up. A single
+	// thread plays it straight through, otherwise the workers take it in chunks.
+	offline_job_t job = { 0 };
+	job.writer = &writer;
+	job.fps = fps;
+	job.frame_count = (int)ceil(get_music_duration() * fps) + 1;
+	job.chunk_frames = thread_count > 1? (int)ceil(OFFLINE_CHUNK_TIME * fps) : job.frame_count;
+	job.slot_count = thread_count > 1? thread_count * job.chunk_frames : fps;
+	job.slots = malloc((size_t)job.slot_count * writer.buffer_size);
+	job.ready = calloc((size_t)job.slot_count, sizeof(bool));
+	job.lock = SDL_CreateMutex();
+	job.changed = SDL_CreateCond();
+	bool success = job.slots && job.ready && job.lock && job.changed;
+	if (!success) {
+		fprintf(stderr, "Unable to allocate offline render buffers!\n");
+	}
+
+	const double ticks = (double)SDL_GetPerformanceFrequency();
+	const uint64_t start = SDL_GetPerformanceCounter();
+	SDL_Thread *threads[OFFLINE_MAX_THREADS];
+	int started = 0;
+	for (; success && started < thread_count; started++) {
+		threads[started] = SDL_CreateThread(offline_worker, "offline_render", &job);
+		if (!threads[started]) {
+			fprintf(stderr, "SDL_CreateThread() failed: %s\n", SDL_GetError());
+			offline_job_fail(&job);
+			success = false;
+			break;
+		}
+	}
+	if (success) {
+		success = offline_write_frames(&job);
+	}
+	for (int i = 0; i < started; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	success = offline_writer_close(&writer) && success;
+
+	// Standard error, since the video may be going to standard output
+	const int frames = job.next_frame;
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / ticks;
+	double draw_seconds = (double)job.draw_ticks / ticks;
+	fprintf(stderr, "Rendered %d frames in %.2fs on %d threads: %.1f frames per second, %.1f drawing only per thread.\n",
+			frames, seconds, started, frames / fmax(seconds, 1e-9), frames / fmax(draw_seconds, 1e-9));
+
+	if (job.lock) SDL_DestroyMutex(job.lock);
+	if (job.changed) SDL_DestroyCond(job.changed);
+	free(job.ready);
+	free(job.slots);
+	return success;
+}
@@ -0,0 +1,40 @@
+//
+//  offline_render.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Renders the gameplay show without a window or audio, stepping the song at a
+// fixed frame rate and writing every frame as fast as it can be drawn. The
+// output is a Y4M video if the path ends in ".y4m" or is "-" for stdout, and
+// otherwise a directory of numbered PPM images.
+//
+// Worker threads each run their own copy of the scenes and render chunks of
+// the show, starting a few seconds early so the particles are in place. The
+// frames are put back in order before they are written.
+
+#ifndef offline_render_h
+#define offline_render_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+	FILE *file; // Y4M stream, or NULL for PPM images
+	const char *directory;
+	int width;
+	int height;
+	size_t buffer_size; // one frame in the output format
+} offline_writer_t;
+
+bool offline_writer_open(offline_writer_t *writer, const char *path, int width, int height, int fps);
+void offline_writer_convert(const offline_writer_t *writer, const uint32_t *pixels, uint8_t *out);
+bool offline_writer_write(offline_writer_t *writer, const uint8_t *data, int frame); // a converted frame
+bool offline_writer_close(offline_writer_t *writer);
+
+// The scenes must be initialized, with init_frame_buffer() and init_offline_audio().
+// thread_count is 0 for one thread per CPU.
+bool offline_render_show(const char *path, int fps, int thread_count);
+
+#endif /* offline_render_h */
@@ -0,0 +1,216 @@
+//
+//  particles.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "particles.h"
+#include "arena.h"
+#include "color.h"
+#include "drawing.h"
+#include "physics.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Streaks are drawn from where the particle was this many seconds ago
+#define PARTICLE_STREAK_TIME (0.05f)
+
+// Particles closer to the camera than this are not drawn
+#define PARTICLE_NEAR_Z (0.1f)
+
+
+bool particles_init(particle_system_t *ps, int capacity) {
+	memset(ps, 0, sizeof(particle_system_t));
+	
+	// All arrays share one allocation
+	const size_t n = (size_t)capacity;
+	const size_t size = sizeof(float) * n * 9 + sizeof(uint32_t) * n + sizeof(particle_style) * n;
+	float *f = malloc(size);
+	if (!f) {
+		fprintf(stderr, "Unable to allocate particles!\n");
+		return false;
+	}
+	ps->x = f; f += n;
+	ps->y = f; f += n;
+	ps->z = f; f += n;
+	ps->vx = f; f += n;
+	ps->vy = f; f += n;
+	ps->vz = f; f += n;
+	ps->ay = f; f += n;
+	ps->age = f; f += n;
+	ps->lifetime = f; f += n;
+	ps->color = (uint32_t *)f;
+	ps->style = (particle_style *)(ps->color + n);
+	
+	ps->capacity = capacity;
+	ps->random_state = 0x2545F491;
+	return true;
+}
+
+void particles_free(particle_system_t *ps) {
+	free(ps->x);
+	memset(ps, 0, sizeof(particle_system_t));
+}
+
+void particles_remove_all(particle_system_t *ps) {
+	ps->count = 0;
+}
+
+#pragma mark - Emitting
+
+float particles_random(particle_system_t *ps) {
+	// xorshift32, so effects are the same every time the show is played
+	uint32_t x = ps->random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ps->random_state = x;
+	return (float)(x >> 8) * (1.0f / 16777216.0f); // [0, 1)
+}
+
+float particles_random_around(particle_system_t *ps, float value, float variation) {
+	return value * (1.0f + variation * (2.0f * particles_random(ps) - 1.0f));
+}
+
+void particles_emit(particle_system_t *ps, const particle_emitter_t *emitter, vec3_t position) {
+	// When full, the burst is cut short rather than replacing live particles
+	int n = emitter->count;
+	if (n > ps->capacity - ps->count) n = ps->capacity - ps->count;
+	
+	for (int k = 0; k < n; k++) {
+		const int i = ps->count++;
+		
+		// Uniform direction on a sphere
+		const float u = 2.0f * particles_random(ps) - 1.0f;
+		const float a = 2.0f * (float)M_PI * particles_random(ps);
+		const float r = sqrtf(1.0f - u * u);
+		const float speed = particles_random_around(ps, emitter->speed, emitter->speed_variation);
+		
+		ps->x[i] = position.x;
+		ps->y[i] = position.y;
+		ps->z[i] = position.z;
+		ps->vx[i] = r * cosf(a) * speed;
+		ps->vy[i] = r * sinf(a) * speed;
+		ps->vz[i] = u * speed;
+		ps->ay[i] = -PHYSICS_GRAVITY * emitter->gravity;
+		ps->age[i] = 0.0f;
+		ps->lifetime[i] = particles_random_around(ps, emitter->lifetime, emitter->lifetime_variation);
+		ps->color[i] = emitter->color;
+		ps->style[i] = emitter->style;
+	}
+}
+
+#pragma mark - Update
+
+void particles_move(particle_system_t *ps, int from, int to) {
+	ps->x[to] = ps->x[from];
+	ps->y[to] = ps->y[from];
+	ps->z[to] = ps->z[from];
+	ps->vx[to] = ps->vx[from];
+	ps->vy[to] = ps->vy[from];
+	ps->vz[to] = ps->vz[from];
+	ps->ay[to] = ps->ay[from];
+	ps->age[to] = ps->age[from];
+	ps->lifetime[to] = ps->lifetime[from];
+	ps->color[to] = ps->color[from];
+	ps->style[to] = ps->style[from];
+}
+
+void particles_update(particle_system_t *ps, double delta_time) {
+	const int n = ps->count;
+	const float dt = (float)delta_time;
+	
+	physics_integrate(ps->vy, ps->ay, n, dt);
+	physics_integrate(ps->x, ps->vx, n, dt);
+	physics_integrate(ps->y, ps->vy, n, dt);
+	physics_integrate(ps->z, ps->vz, n, dt);
+	float *age = ps->age;
+	for (int i = 0; i < n; i++) {
+		age[i] += dt;
+	}
+	
+	// Recycle expired particles by moving the last live particle into their place
+	int count = n;
+	for (int i = 0; i < count; ) {
+		if (age[i] >= ps->lifetime[i]) {
+			count--;
+			if (i != count) particles_move(ps, count, i);
+		} else {
+			i++;
+		}
+	}
+	ps->count = count;
+}
+
+#pragma mark - Drawing
+
+void particles_draw(const particle_system_t *ps) {
+	const int n = ps->count;
+	if (n == 0) return;
+	
+	// Project all particles in one pass into scratch arrays, then draw them
+	arena_mark_t mark = arena_mark(&frame_arena);
+	float *sx = arena_alloc(&frame_arena, sizeof(float) * (size_t)n * 3);
+	if (!sx) return;
+	float *sy = sx + n;
+	float *sz = sy + n;
+	
+	const affine3_t c = draw_context->camera_transform_3d;
+	const affine2_t v = draw_context->view_transform_2d;
+	for (int i = 0; i < n; i++) {
+		const float x = ps->x[i], y = ps->y[i], z = ps->z[i];
+		const float cx = c.m[0][0] * x + c.m[0][1] * y + c.m[0][2] * z + c.m[0][3];
+		const float cy = c.m[1][0] * x + c.m[1][1] * y + c.m[1][2] * z + c.m[1][3];
+		const float cz = c.m[2][0] * x + c.m[2][1] * y + c.m[2][2] * z + c.m[2][3];
+		const float w = 1.0f / fmaxf(cz, PARTICLE_NEAR_Z);
+		const float px = cx * w, py = cy * w;
+		sx[i] = v.m[0][0] * px + v.m[0][1] * py + v.m[0][2];
+		sy[i] = v.m[1][0] * px + v.m[1][1] * py + v.m[1][2];
+		sz[i] = cz;
+	}
+	
+	const int w = get_screen_width();
+	const int h = get_screen_height();
+	for (int i = 0; i < n; i++) {
+		if (sz[i] < PARTICLE_NEAR_Z) continue;
+		const int x = (int)sx[i];
+		const int y = (int)sy[i];
+		if (x < -2 || y < -2 || x >= w + 2 || y >= h + 2) continue;
+		
+		// Fade out over the particle's life
+		const float opacity = 1.0f - ps->age[i] / ps->lifetime[i];
+		const uint32_t color = color_mul_opacity(ps->color[i], opacity);
+		
+		switch (ps->style[i]) {
+			case PARTICLE_PIXEL:
+				set_pixel(x, y, color);
+				break;
+			case PARTICLE_POINT:
+				set_fill_color_abgr(color);
+				fill_point(x, y);
+				break;
+			case PARTICLE_ROUND_POINT:
+				set_fill_color_abgr(color);
+				fill_round_point(x, y);
+				break;
+			case PARTICLE_STREAK: {
+				vec3_t tail = {
+					ps->x[i] - ps->vx[i] * PARTICLE_STREAK_TIME,
+					ps->y[i] - ps->vy[i] * PARTICLE_STREAK_TIME,
+					ps->z[i] - ps->vz[i] * PARTICLE_STREAK_TIME
+				};
+				tail = vec3_affine3_multiply(tail, c);
+				if (tail.z < PARTICLE_NEAR_Z) break;
+				set_line_color_abgr(color);
+				move_to(perspective_project_camera_point(tail));
+				line_to(vec2_make(sx[i], sy[i]));
+				break;
+			}
+		}
+	}
+	arena_restore(&frame_arena, mark);
+}
@@ -0,0 +1,62 @@
+//
+//  particles.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Particle system for effects with thousands of small elements, such as sparks
+// and smoke. Particles are stored as parallel arrays with a fixed capacity, and
+// live particles are kept packed at the front so each pass is a linear sweep.
+
+#ifndef particles_h
+#define particles_h
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum : uint8_t {
+	PARTICLE_PIXEL,	// single pixel, for dense effects
+	PARTICLE_POINT,	// 3x3 point
+	PARTICLE_ROUND_POINT, // 5x5 circle
+	PARTICLE_STREAK,	// line trailing behind the particle along its velocity
+} particle_style;
+
+typedef struct {
+	int count; // live particles
+	int capacity;
+	
+	// Physics, in world space
+	float *x, *y, *z; // meters
+	float *vx, *vy, *vz; // meters/second
+	float *ay; // meters/second^2, gravity or buoyancy
+	float *age, *lifetime; // seconds
+	
+	// Appearance
+	uint32_t *color;
+	particle_style *style;
+	
+	uint32_t random_state;
+} particle_system_t;
+
+// Burst of particles sent out in random directions from a point
+typedef struct {
+	int count;
+	float speed; // meters/second
+	float speed_variation; // fraction of speed
+	float lifetime; // seconds
+	float lifetime_variation; // fraction of lifetime
+	float gravity; // 1.0 for normal gravity, negative to rise
+	uint32_t color;
+	particle_style style;
+} particle_emitter_t;
+
+bool particles_init(particle_system_t *ps, int capacity);
+void particles_free(particle_system_t *ps);
+void particles_remove_all(particle_system_t *ps);
+
+void particles_emit(particle_system_t *ps, const particle_emitter_t *emitter, vec3_t position);
+void particles_update(particle_system_t *ps, double delta_time);
+void particles_draw(const particle_system_t *ps);
+
+#endif /* particles_h */
@@ -0,0 +1,47 @@
+//
+//  physics.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "physics.h"
+
+#include <string.h>
+
+// GCC and Clang vector extensions compile to SSE, NEON or WebAssembly SIMD,
+// and are split into scalar operations on targets without them.
+#if defined(__GNUC__) || defined(__clang__)
+#define PHYSICS_USE_VECTOR_EXTENSIONS 1
+typedef float physics_float4_t __attribute__((vector_size(16)));
+#endif
+
+
+void physics_integrate(float *values, const float *rates, int count, float dt) {
+	int i = 0;
+#ifdef PHYSICS_USE_VECTOR_EXTENSIONS
+	// Eight floats per iteration. memcpy() is used because the arrays need not be aligned.
+	const physics_float4_t vdt = { dt, dt, dt, dt };
+	for (; i + 8 <= count; i += 8) {
+		physics_float4_t v0, v1, r0, r1;
+		memcpy(&v0, values + i, sizeof(v0));
+		memcpy(&v1, values + i + 4, sizeof(v1));
+		memcpy(&r0, rates + i, sizeof(r0));
+		memcpy(&r1, rates + i + 4, sizeof(r1));
+		v0 += r0 * vdt;
+		v1 += r1 * vdt;
+		memcpy(values + i, &v0, sizeof(v0));
+		memcpy(values + i + 4, &v1, sizeof(v1));
+	}
+#endif
+	for (; i < count; i++) {
+		values[i] += rates[i] * dt;
+	}
+}
+
+void physics_apply_gravity(vec3_t *momenta, const bool *gravity, int count, float dt) {
+	const float dv = PHYSICS_GRAVITY * dt;
+	for (int i = 0; i < count; i++) {
+		if (gravity[i]) momenta[i].y -= dv;
+	}
+}
@@ -0,0 +1,25 @@
+//
+//  physics.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Batch integration over contiguous arrays, for moving many objects at once.
+// Arrays of vec2_t or vec3_t can be passed as floats, since their components
+// are stored one after another.
+
+#ifndef physics_h
+#define physics_h
+
+#include "vector.h"
+#include <stdbool.h>
+
+#define PHYSICS_GRAVITY (9.8f) // meters/second^2
+
+// values[i] += rates[i] * dt for count floats
+void physics_integrate(float *values, const float *rates, int count, float dt);
+
+// Accelerate downward the momenta whose gravity flag is set
+void physics_apply_gravity(vec3_t *momenta, const bool *gravity, int count, float dt);
+
+#endif /* physics_h */
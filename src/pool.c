@@ -0,0 +1,47 @@
+//
+//  pool.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+size_t pool_slot_size(const pool_t *pool) {
+	// Each free slot holds a pointer to the next free slot
+	const size_t align = sizeof(void *) > 16? sizeof(void *) : 16;
+	size_t size = pool->element_size > sizeof(void *)? pool->element_size : sizeof(void *);
+	return (size + align - 1) & ~(align - 1);
+}
+
+void *pool_alloc(pool_t *pool) {
+	if (!pool->free_list) {
+		// Add a block of slots to the free list. Blocks are kept for the lifetime of the pool.
+		const size_t slot = pool_slot_size(pool);
+		const int n = pool->elements_per_block;
+		char *block = malloc(slot * (size_t)n);
+		if (!block) {
+			fprintf(stderr, "Unable to allocate pool block!\n");
+			return NULL;
+		}
+		for (int i = n - 1; i >= 0; i--) {
+			void **p = (void **)(block + slot * (size_t)i);
+			*p = pool->free_list;
+			pool->free_list = p;
+		}
+	}
+	
+	void **p = pool->free_list;
+	pool->free_list = *p;
+	return p;
+}
+
+void pool_free(pool_t *pool, void *p) {
+	if (!p) return;
+	*(void **)p = pool->free_list;
+	pool->free_list = p;
+}
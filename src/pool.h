@@ -0,0 +1,26 @@
+//
+//  pool.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Pool of fixed-size objects, allocated in blocks so that objects of the
+// same type sit next to each other in memory. Freed objects are reused.
+
+#ifndef pool_h
+#define pool_h
+
+#include <stddef.h>
+
+typedef struct {
+	size_t element_size;
+	int elements_per_block;
+	void *free_list;
+} pool_t;
+
+#define POOL_INIT(type, count) { sizeof(type), (count), NULL }
+
+void *pool_alloc(pool_t *pool);
+void pool_free(pool_t *pool, void *p);
+
+#endif /* pool_h */
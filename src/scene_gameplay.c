@@ -10,6 +10,7 @@
 #include "audio_player.h"
 #include "color.h"
 #include "drawing.h"
+#include "hot_reload.h"
 #include "image.h"
 #include "mesh.h"
 #include "mesh_creation.h"
@@ -19,96 +20,177 @@
 
 
 // Globals
-double time_remaining = -1.0;
-double last_music_position = 0.0;
+timeline_t gameplay_show;
 
-// Scene objects and parameters
-gameplay_t *gameplay_scene_data = NULL;
+#define GAMEPLAY_PARTICLE_CAPACITY (16384)
+#define PUNCH_PERFECT_WINDOW (0.050) // seconds before or after the beat
+#define PUNCH_GOOD_WINDOW (0.100)
+#define PUNCH_FEEDBACK_TIME (0.5) // seconds the judgement stays on screen
 
 
+bool gameplay_reload_timeline(const char *path, void *context) {
+	// Swap in the edited show, and pick it up from where the song is now.
+	// Only the main thread watches the file, so this is the main thread's scene.
+	(void)path;
+	timeline_t *show = context;
+	gameplay_t *scene = scene_context->gameplay;
+	timeline_t edited;
+	if (!scene || !sequencer_load_show(&edited)) return false;
+	if (!sequencer_reload(scene, &edited)) {
+		timeline_free(&edited);
+		return false;
+	}
+	timeline_free(show);
+	*show = edited;
+	if (scene_context->index == SCENE_GAMEPLAY && scene->last_music_position >= 0.0) {
+		sequencer_seek(scene, scene->last_music_position);
+	}
+	return true;
+}
+
+void gameplay_load_show(void) {
+	// On the main thread before the scenes are created, so worker threads
+	// neither load the timeline nor watch it
+	sequencer_load_show(&gameplay_show);
+	hot_reload_watch(SEQUENCER_TIMELINE_PATH, gameplay_reload_timeline, &gameplay_show);
+}
+
+void gameplay_free_show(void) {
+	timeline_free(&gameplay_show);
+}
+
 void gameplay_init(void) {
-	gameplay_scene_data = malloc(sizeof(gameplay_t));
-	if (!gameplay_scene_data) {
+	gameplay_t *scene = malloc(sizeof(gameplay_t));
+	scene_context->gameplay = scene;
+	if (!scene) {
 		fprintf(stderr, "Could not allocate memory for g_gameplay!\n");
 		return;
 	}
-	gameplay_scene_data->bg_color = COLOR_ABGR_BLACK;
+	*scene = (gameplay_t){ .bg_color = COLOR_ABGR_BLACK, .arena = { NULL, 256 * 1024 }, .time_remaining = -1.0 };
+	
+	// Everything created for this scene comes from the scene's arena, so the meshes
+	// and shapes are packed together and can be freed with a single arena_free().
+	arena_t *arena = &scene->arena;
+	scene_arena = arena;
 
 	// Allocate memory to hold all the meshes and shapes that will be used in this scene.
-	gameplay_scene_data->shapes = array_list_new(256);
-	if (!gameplay_scene_data->shapes) {
-		fprintf(stderr, "Could not allocate memory for shapes!\n");
+	shape_list_init(&scene->shapes, arena);
+	mesh_list_init(&scene->meshes, arena);
+	if (!shape_list_reserve(&scene->shapes, 256) || !mesh_list_reserve(&scene->meshes, 256)) {
+		fprintf(stderr, "Could not allocate memory for shapes and meshes!\n");
+		scene_arena = NULL;
 		return;
 	}
-	gameplay_scene_data->meshes = array_list_new(256);
-	if (!gameplay_scene_data->meshes) {
-		fprintf(stderr, "Could not allocate memory for meshes!\n");
+	
+	if (!particles_init(&scene->particles, GAMEPLAY_PARTICLE_CAPACITY)) {
+		scene_arena = NULL;
 		return;
 	}
 	
-	sequencer_init(gameplay_scene_data);
+	sequencer_init(scene, &gameplay_show);
+	scene_arena = NULL;
+}
+
+void gameplay_free(void) {
+	// The meshes, shapes and their lists all go with the scene's arena
+	gameplay_t *scene = scene_context->gameplay;
+	if (!scene) return;
+	sequencer_free(scene);
+	particles_free(&scene->particles);
+	arena_free(&scene->arena);
+	free(scene);
+	scene_context->gameplay = NULL;
 }
 
 void gameplay_start(void) {
-	time_remaining = -1.0;
-	last_music_position = -1.0;
-	scene_lifetime = 0.0;
+	gameplay_t *scene = scene_context->gameplay;
+	scene->time_remaining = -1.0;
+	scene->last_music_position = -1.0;
+	scene->last_punch = PunchNone;
+	scene_context->lifetime = 0.0;
 	
 	// Add shapes and meshes to list of objects in scene
-	shape_t **s = (shape_t **)gameplay_scene_data->shapes->array;
-	int sn = gameplay_scene_data->shapes->length;
+	shape_t **s = scene->shapes.array;
+	int sn = scene->shapes.length;
 	for (int i=0; i<sn; i++) {
 		scene_add_shape(s[i]);
 	}
-	mesh_t **m = (mesh_t **)gameplay_scene_data->meshes->array;
-	int mn = gameplay_scene_data->meshes->length;
+	mesh_t **m = scene->meshes.array;
+	int mn = scene->meshes.length;
 	for (int i=0; i<mn; i++) {
 		scene_add_mesh(m[i]);
 	}
 	
 	// Restart sequencer
-	sequencer_start(gameplay_scene_data);
+	sequencer_start(scene);
 
 	// Start playing music
 	start_music();
-	is_scene_paused = false;
+	scene_context->is_paused = false;
+}
+
+void gameplay_seek(double position) {
+	// Jump the music and put the scene in the state it would have at that time
+	gameplay_t *scene = scene_context->gameplay;
+	set_music_position(position);
+	scene->last_music_position = get_music_position();
+	sequencer_seek(scene, scene->last_music_position);
+}
+
+punch_judgement gameplay_judge_punch(double position) {
+	// Early and late punches count the same
+	const beat_map_t *map = sequencer_beat_map(scene_context->gameplay);
+	if (!map) return PunchNone;
+	double beat = round(beat_map_beat_at(map, position));
+	double error = fabs(position - beat_map_time_at(map, beat));
+	if (error <= PUNCH_PERFECT_WINDOW) return PunchPerfect;
+	if (error <= PUNCH_GOOD_WINDOW) return PunchGood;
+	return PunchMiss;
+}
+
+void gameplay_punch(void) {
+	gameplay_t *scene = scene_context->gameplay;
+	if (scene_context->is_paused || !is_music_playing()) return;
+	scene->last_punch = gameplay_judge_punch(get_music_position());
+	scene->last_punch_lifetime = scene_context->lifetime;
 }
 
 bool gameplay_handle_keyboard(SDL_Event event) {
 	if (event.type == SDL_KEYDOWN) {
 		switch (event.key.keysym.sym) {
 			case SDLK_a:
-				// Punch left
+				// Punch left, once per key press
+				if (!event.key.repeat) gameplay_punch();
 				return true;
 			case SDLK_d:
-				// Punch right
+				// Punch right, once per key press
+				if (!event.key.repeat) gameplay_punch();
 				return true;
 			case SDLK_ESCAPE:
 			case SDLK_p:
 				// Pause game
-				is_scene_paused = !is_scene_paused;
-				pause_music(is_scene_paused);
+				scene_context->is_paused = !scene_context->is_paused;
+				pause_music(scene_context->is_paused);
 				return true;
 			case SDLK_q:
 				// Quit to title if paused
-				if (is_scene_paused) set_scene_index(SCENE_TITLE);
+				if (scene_context->is_paused) set_scene_index(SCENE_TITLE);
 				return true;
 			case SDLK_r:
 				// Restart song if paused
-				if (is_scene_paused) gameplay_start();
+				if (scene_context->is_paused) gameplay_start();
 				return true;
 			case SDLK_x:
 				// Skip to results scene if paused
-				if (is_scene_paused) set_scene_index(SCENE_RESULTS);
+				if (scene_context->is_paused) set_scene_index(SCENE_RESULTS);
 				return true;
 			case SDLK_j:
 				// Skip back 10 seconds
-				set_music_position(get_music_position() - 10.0);
-				last_music_position = -1.0; // reset sequencer from beginning
+				gameplay_seek(get_music_position() - 10.0);
 				return true;
 			case SDLK_l:
 				// Skip forward 10 seconds
-				set_music_position(get_music_position() + 10.0);
+				gameplay_seek(get_music_position() + 10.0);
 				return true;
 		}
 	}
@@ -118,23 +200,25 @@ bool gameplay_handle_keyboard(SDL_Event event) {
 
 void gameplay_update(double delta_time) {
 	// Do not update if paused
-	if (is_scene_paused) return;
+	gameplay_t *scene = scene_context->gameplay;
+	if (scene_context->is_paused) return;
 
 	// Update song progress bar
 	double fraction = 0.0;
-	time_remaining = -1.0;
+	scene->time_remaining = -1.0;
 	if (is_music_playing()) {
 		double total = get_music_duration();
 		if (total > 0.0) {
 			double position = get_music_position();
-			time_remaining = total - position;
+			scene->time_remaining = total - position;
 			fraction = position / total;
-			sequencer_update(gameplay_scene_data, last_music_position, position);
-			last_music_position = position;
+			sequencer_update(scene, scene->last_music_position, position);
+			scene->last_music_position = position;
 		}
+		particles_update(&scene->particles, delta_time);
 	} else {
 		// Advance to results scene if song has played through
-		if (last_music_position > 0.0) {
+		if (scene->last_music_position > 0.0) {
 			set_scene_index(SCENE_RESULTS);
 		}
 	}
@@ -142,26 +226,28 @@ void gameplay_update(double delta_time) {
 }
 
 void gameplay_render(void) {
+	gameplay_t *scene = scene_context->gameplay;
 	vec2_t p;
 	int scr_w = get_screen_width();
 	int scr_h = get_screen_height();
 
-	set_fill_color_abgr(gameplay_scene_data->bg_color);
+	set_fill_color_abgr(scene->bg_color);
 	fill_screen();
 	
 	// Draw meshes and shapes
 	draw_shapes();
 	draw_meshes();
+	particles_draw(&scene->particles);
 
 	// Draw song progress bar
 	draw_progress_bar();
 	
 	// Draw remaining time text
-	uint8_t br = color_brightness(gameplay_scene_data->bg_color);
-	uint32_t text_color = (br > 127 || scene_lifetime < 1.0)? COLOR_RGB_BLACK : COLOR_RGB_WHITE;
+	uint8_t br = color_brightness(scene->bg_color);
+	uint32_t text_color = (br > 127 || scene_context->lifetime < 1.0)? COLOR_RGB_BLACK : COLOR_RGB_WHITE;
 	set_fill_color_rgba(text_color, 127);
-	if (time_remaining >= 0.0) {
-		int seconds = (int)ceil(time_remaining);
+	if (scene->time_remaining >= 0.0) {
+		int seconds = (int)ceil(scene->time_remaining);
 		int minutes = seconds / 60;
 		seconds = seconds % 60;
 		char s[16];
@@ -179,6 +265,16 @@ void gameplay_render(void) {
 	set_fill_color_rgba(text_color, 127);
 	atari_draw_text("Toma - All Night Radio", 1);
 
+	// Draw judgement of the last punch
+	const char *const punch_text[] = { NULL, "Miss", "Good", "Perfect!" };
+	if (scene->last_punch != PunchNone && scene_context->lifetime - scene->last_punch_lifetime < PUNCH_FEEDBACK_TIME) {
+		p.x = scr_w / 2;
+		p.y = scr_h - 20;
+		move_to(p);
+		set_fill_color_rgba(scene->last_punch == PunchMiss? COLOR_RGB_GRAY_80 : COLOR_RGB_WHITE, 192);
+		atari_draw_centered_text(punch_text[scene->last_punch], 1);
+	}
+
 //	p.x = scr_w - 9 * 8 - 4;
 //	p.y = scr_h - 10;
 //	move_to(p);
@@ -192,7 +288,7 @@ void gameplay_render(void) {
 //	atari_draw_text(":Punch", 1);
 	
 	// Draw pause menu
-	if (is_scene_paused) {
+	if (scene_context->is_paused) {
 		
 		rectangle_t text_rect;
 		text_rect.w = 15 * 8;
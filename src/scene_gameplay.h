@@ -8,21 +8,52 @@
 #ifndef scene_gameplay_h
 #define scene_gameplay_h
 
-#include "array_list.h"
+#include "arena.h"
+#include "mesh.h"
+#include "particles.h"
+#include "shape.h"
+#include "timeline.h"
 
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdint.h>
 
+// Punches are judged by their distance from the nearest beat of the song
+typedef enum : uint32_t {
+	PunchNone,
+	PunchMiss,
+	PunchGood,
+	PunchPerfect,
+} punch_judgement;
+
+typedef struct sequencer_s sequencer_t; // plays the show, see sequencer.c
+
 // Scene parameters
 typedef struct {
 	uint32_t bg_color;
-	array_list_t *shapes;
-	array_list_t *meshes;
+	shape_list_t shapes;
+	mesh_list_t meshes;
+	particle_system_t particles;
+	arena_t arena; // owns the shapes, meshes and sequencer
+	sequencer_t *sequencer;
+	double time_remaining;
+	double last_music_position;
+	punch_judgement last_punch;
+	double last_punch_lifetime;
 } gameplay_t;
 
+// The show, loaded by gameplay_load_show() on the main thread before any scene
+// is created. The gameplay scenes of every thread only read it.
+extern timeline_t gameplay_show;
+
+void gameplay_load_show(void);
+void gameplay_free_show(void);
+
 void gameplay_init(void);
+void gameplay_free(void);
 void gameplay_start(void);
+void gameplay_seek(double position);
+punch_judgement gameplay_judge_punch(double position);
 bool gameplay_handle_keyboard(SDL_Event event);
 void gameplay_update(double delta_time);
 void gameplay_render(void);
@@ -12,44 +12,53 @@
 #include "image.h"
 #include "scene_manager.h"
 
+#include "arena.h"
 #include "mesh.h"
 #include "mesh_creation.h"
 
 
-// Globals
-mesh_t *mesh1 = NULL;
-mesh_t *mesh2 = NULL;
-
-
 void instructions_init(void) {
+	instructions_t *instructions = &scene_context->instructions;
+	scene_arena = &instructions->arena;
 	
 	// Testing
 	//mesh1 = mesh_create_grid(8);
 	//mesh1 = mesh_create_diamond(4, 1.0f, 1.0f);
-	mesh1 = mesh_create_3d_character('a');
+	instructions->mesh1 = mesh_create_3d_character('a');
 
 	//mesh2 = mesh_create_pyramid();
-	mesh2 = mesh_create_sphere(2);
+	instructions->mesh2 = mesh_create_sphere(2);
 	//mesh2 = mesh_create_cube();
+	
+	scene_arena = NULL;
+}
+
+void instructions_free(void) {
+	instructions_t *instructions = &scene_context->instructions;
+	arena_free(&instructions->arena);
+	instructions->mesh1 = NULL;
+	instructions->mesh2 = NULL;
 }
 
 void instructions_start(void) {
+	mesh_t *mesh1 = scene_context->instructions.mesh1;
+	mesh_t *mesh2 = scene_context->instructions.mesh2;
 	const float deg = (float)M_PI / 180.0f;
 	
 	// Character
-	mesh1->position = vec3_make(-2.5, 0, 0);
-	mesh1->linear_momentum = vec3_zero();
-	mesh1->rotation = vec3_zero();
-	mesh1->angular_momentum = vec3_make(0, 0.5f * deg, 0.0f * deg);
+	mesh_set_position(mesh1, vec3_make(-2.5, 0, 0));
+	mesh_set_linear_momentum(mesh1, vec3_zero());
+	mesh_set_rotation(mesh1, vec3_zero());
+	mesh_set_angular_momentum(mesh1, vec3_make(0, 30 * deg, 0.0f * deg));
 
 	// Bouncing sphere
-	mesh2->position = vec3_make(2.5, 0, 0);
-	mesh2->linear_momentum = vec3_zero();
-	mesh2->rotation = vec3_zero();
-	mesh2->angular_momentum = vec3_make(0, -2 * deg, deg);
+	mesh_set_position(mesh2, vec3_make(2.5, 0, 0));
+	mesh_set_linear_momentum(mesh2, vec3_zero());
+	mesh_set_rotation(mesh2, vec3_zero());
+	mesh_set_angular_momentum(mesh2, vec3_make(0, -120 * deg, 60 * deg));
 	
 	// Set translation momentum & gravity
-	mesh2->gravity = true;
+	mesh_set_gravity(mesh2, true);
 	
 	// Add meshes to scene
 	scene_add_mesh(mesh1);
@@ -70,7 +79,9 @@ bool instructions_handle_keyboard(SDL_Event event) {
 }
 
 void instructions_update(double delta_time) {
-	double t = scene_lifetime;
+	mesh_t *mesh1 = scene_context->instructions.mesh1;
+	mesh_t *mesh2 = scene_context->instructions.mesh2;
+	double t = scene_context->lifetime;
 	
 	// Color cycling
 	int hue = (int)round(t * 60.0) % 360;
@@ -81,8 +92,10 @@ void instructions_update(double delta_time) {
 	mesh_set_children_color(mesh2, line_color, point_color);
 	
 	// Reset momentum when cube hits bottom
-	if (mesh2->position.y < -1.0f) {
-		mesh2->linear_momentum.y = 7.0f;
+	if (mesh_get_position(mesh2).y < -1.0f) {
+		vec3_t momentum = mesh_get_linear_momentum(mesh2);
+		momentum.y = 7.0f;
+		mesh_set_linear_momentum(mesh2, momentum);
 	}
 }
 
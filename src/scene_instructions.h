@@ -8,11 +8,22 @@
 #ifndef scene_instructions_h
 #define scene_instructions_h
 
+#include "arena.h"
+#include "mesh.h"
+
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdint.h>
 
+// Scene objects
+typedef struct {
+	mesh_t *mesh1;
+	mesh_t *mesh2;
+	arena_t arena; // owns the meshes
+} instructions_t;
+
 void instructions_init(void);
+void instructions_free(void);
 void instructions_start(void);
 bool instructions_handle_keyboard(SDL_Event event);
 void instructions_update(double delta_time);
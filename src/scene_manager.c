@@ -7,25 +7,30 @@
 
 #include "scene_manager.h"
 #include "audio_player.h"
-#include "array_list.h"
+#include "slot_map.h"
 #include <stdio.h>
 
 
-// Globals
-SCENE_INDEX scene_index = SCENE_STARTUP;
-double scene_lifetime = 0.0;
-array_list_t *shape_list;
-array_list_t *mesh_list;
-bool is_scene_paused = false;
+// Scene context: the main thread's, unless the thread has set its own
+scene_context_t scene_main_context;
+_Thread_local scene_context_t *scene_context = &scene_main_context;
 
+// Depth first lists of the scene's trees are used instead of the trees
+bool use_flat_scene_graph = true;
+
+
+void set_scene_context(scene_context_t *context) {
+	scene_context = context? context : &scene_main_context;
+}
 
 void scene_manager_init(void) {
-	// Create array lists
-	shape_list = array_list_new(16);
-	mesh_list = array_list_new(16);
-	if (!shape_list || !mesh_list) {
-		fprintf(stderr, "Could not increase size of array_list.\n");
-	}
+	// Create scene object lists
+	scene_context_t *sc = scene_context;
+	*sc = (scene_context_t){ .index = SCENE_STARTUP, .render_interpolation = 1.0f, .graphs_dirty = true };
+	slot_map_init(&sc->shapes);
+	slot_map_init(&sc->meshes);
+	mesh_graph_init(&sc->mesh_graph);
+	shape_graph_init(&sc->shape_graph);
 	
 	// Init all scenes
 	title_init();
@@ -34,32 +39,74 @@ void scene_manager_init(void) {
 	results_init();
 }
 
-void scene_add_mesh(mesh_t *mesh) {
-	bool success = array_list_add(mesh_list, mesh);
-	if (!success) {
+void scene_manager_free(void) {
+	// The graphs give their nodes' state back, so they go before the objects
+	scene_context_t *sc = scene_context;
+	mesh_graph_free(&sc->mesh_graph);
+	shape_graph_free(&sc->shape_graph);
+	
+	// Each scene's objects come from its own arena, so this is a few frees per scene
+	title_free();
+	instructions_free();
+	gameplay_free();
+	results_free();
+	
+	slot_map_free(&sc->shapes);
+	slot_map_free(&sc->meshes);
+	mesh_free_projected_vertices();
+	sc->graphs_dirty = true;
+	sc->index = SCENE_STARTUP;
+}
+
+bool scene_add_mesh(mesh_t *mesh) {
+	slot_handle_t handle = slot_map_insert(&scene_context->meshes, mesh);
+	scene_context->graphs_dirty = true;
+	if (handle.generation == 0) {
 		fprintf(stderr, "Could not add to mesh_list.\n");
+		return false;
 	}
+	return true;
 }
 
-void scene_add_shape(shape_t *shape) {
-	bool success = array_list_add(shape_list, shape);
-	if (!success) {
+bool scene_add_shape(shape_t *shape) {
+	slot_handle_t handle = slot_map_insert(&scene_context->shapes, shape);
+	scene_context->graphs_dirty = true;
+	if (handle.generation == 0) {
 		fprintf(stderr, "Could not add to shape_list.\n");
+		return false;
 	}
+	return true;
+}
+
+void scene_update_graphs(void) {
+	if (scene_context->graphs_dirty || scene_context->mesh_graph.tree_version != mesh_tree_version) {
+		mesh_graph_build(&scene_context->mesh_graph, (mesh_t **)scene_context->meshes.values.array, scene_context->meshes.values.length);
+	}
+	if (scene_context->graphs_dirty || scene_context->shape_graph.tree_version != shape_tree_version) {
+		shape_graph_build(&scene_context->shape_graph, (shape_t **)scene_context->shapes.values.array, scene_context->shapes.values.length);
+	}
+	scene_context->graphs_dirty = false;
+}
+
+void scene_release_graphs(void) {
+	mesh_graph_release(&scene_context->mesh_graph);
+	shape_graph_release(&scene_context->shape_graph);
+	scene_context->graphs_dirty = true;
 }
 
 void set_scene_index(SCENE_INDEX x) {
-	array_list_remove_all(shape_list);
-	array_list_remove_all(mesh_list);
+	slot_map_remove_all(&scene_context->shapes);
+	slot_map_remove_all(&scene_context->meshes);
+	scene_context->graphs_dirty = true;
 	
 	// Stop audio player
 	stop_music();
 		
 	// Unpause
-	is_scene_paused = false;
+	scene_context->is_paused = false;
 
-	scene_index = x;
-	switch (scene_index) {
+	scene_context->index = x;
+	switch (scene_context->index) {
 		case SCENE_TITLE:
 			title_start();
 			break;
@@ -76,11 +123,19 @@ void set_scene_index(SCENE_INDEX x) {
 			break;
 	}
 
-	scene_lifetime = 0.0;
+	scene_context->lifetime = 0.0;
 }
 
 void update_scene(double delta_time) {
-	switch (scene_index) {
+	if (use_flat_scene_graph) {
+		// Remember where everything was before the scene's scripts and physics move it.
+		// This also happens while paused, so nothing is drawn part way through a step.
+		scene_update_graphs();
+		mesh_graph_save_previous(&scene_context->mesh_graph);
+		shape_graph_save_previous(&scene_context->shape_graph);
+	}
+	
+	switch (scene_context->index) {
 		case SCENE_TITLE:
 			title_update(delta_time);
 			break;
@@ -97,25 +152,32 @@ void update_scene(double delta_time) {
 			break;
 	}
 	
-	if (!is_scene_paused) {
-		mesh_t **m = (mesh_t **)mesh_list->array;
-		int mn = mesh_list->length;
+	if (!scene_context->is_paused && use_flat_scene_graph) {
+		scene_update_graphs();
+		mesh_graph_update(&scene_context->mesh_graph, delta_time);
+		shape_graph_update(&scene_context->shape_graph, delta_time);
+	} else if (!scene_context->is_paused) {
+		// The trees are updated directly, so the graphs give the meshes and shapes their state back
+		scene_release_graphs();
+		
+		mesh_t **m = (mesh_t **)scene_context->meshes.values.array;
+		int mn = scene_context->meshes.values.length;
 		for (int i = 0; i < mn; i++) {
 			mesh_update(m[i], delta_time);
 		}
 		
-		shape_t **s = (shape_t **)shape_list->array;
-		int sn = shape_list->length;
+		shape_t **s = (shape_t **)scene_context->shapes.values.array;
+		int sn = scene_context->shapes.values.length;
 		for (int i = 0; i < sn; i++) {
 			shape_update(s[i], delta_time);
 		}
 	}
 
-	scene_lifetime += delta_time;
+	scene_context->lifetime += delta_time;
 }
 
 void draw_scene(void) {
-	switch (scene_index) {
+	switch (scene_context->index) {
 		case SCENE_TITLE:
 			title_render();
 			break;
@@ -134,16 +196,30 @@ void draw_scene(void) {
 }
 
 void draw_meshes(void) {
-	mesh_t **m = (mesh_t **)mesh_list->array;
-	int mn = mesh_list->length;
+	if (use_flat_scene_graph) {
+		scene_update_graphs();
+		mesh_graph_draw(&scene_context->mesh_graph, scene_context->render_interpolation);
+		return;
+	}
+	scene_release_graphs();
+	
+	mesh_t **m = (mesh_t **)scene_context->meshes.values.array;
+	int mn = scene_context->meshes.values.length;
 	for (int i = 0; i < mn; i++) {
 		mesh_draw(m[i]);
 	}
 }
 
 void draw_shapes(void) {
-	shape_t **s = (shape_t **)shape_list->array;
-	int sn = shape_list->length;
+	if (use_flat_scene_graph) {
+		scene_update_graphs();
+		shape_graph_draw(&scene_context->shape_graph, scene_context->render_interpolation);
+		return;
+	}
+	scene_release_graphs();
+	
+	shape_t **s = (shape_t **)scene_context->shapes.values.array;
+	int sn = scene_context->shapes.values.length;
 
 	for (int i = 0; i < sn; i++) {
 		shape_draw(s[i]);
@@ -14,6 +14,11 @@
 #include "scene_results.h"
 #include "mesh.h"
 #include "shape.h"
+#include "slot_map.h"
+
+// Scenes are updated in fixed steps of this many seconds
+#define UPDATE_STEP_RATE (120) // steps per second
+#define UPDATE_STEP_TIME (1.0 / UPDATE_STEP_RATE)
 
 // Game Scenes
 typedef enum {
@@ -24,13 +29,43 @@ typedef enum {
 	SCENE_RESULTS		/**< Results scene */
 } SCENE_INDEX;
 
-extern double scene_lifetime;
-extern bool is_scene_paused;
-extern SCENE_INDEX scene_index;
+// Scene context: the current scene, its objects and the data of every scene.
+// Each thread runs the scenes in its own current context.
+typedef struct {
+	SCENE_INDEX index;
+	double lifetime;
+	bool is_paused;
+	float render_interpolation; // 0-1, fraction of an update step since the last update
+	
+	// Objects in the current scene, and depth first lists of their trees,
+	// rebuilt when objects or children are added or removed
+	slot_map_t shapes;
+	slot_map_t meshes;
+	mesh_graph_t mesh_graph;
+	shape_graph_t shape_graph;
+	bool graphs_dirty;
+	
+	title_t title;
+	instructions_t instructions;
+	gameplay_t *gameplay;
+} scene_context_t;
+
+extern scene_context_t scene_main_context;
+extern _Thread_local scene_context_t *scene_context;
+
+void set_scene_context(scene_context_t *context); // NULL for the main thread's context
+
+// Update and draw the scene through depth first lists of the mesh and shape trees
+// instead of recursing through each tree
+extern bool use_flat_scene_graph;
+
+void scene_manager_init(void); // sets up the current context and its scenes
+void scene_manager_free(void); // frees every scene and the object lists
 
-void scene_manager_init(void);
-void scene_add_mesh(mesh_t *mesh);
-void scene_add_shape(shape_t *shape);
+// Objects in the current scene, until the scene changes. Scenes hide objects
+// rather than removing them, so objects are only removed all at once.
+bool scene_add_mesh(mesh_t *mesh);
+bool scene_add_shape(shape_t *shape);
 
 void set_scene_index(SCENE_INDEX x);
 
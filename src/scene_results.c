@@ -17,6 +17,10 @@ void results_init(void) {
 	
 }
 
+void results_free(void) {
+	
+}
+
 void results_start(void) {
 	
 }
@@ -6,21 +6,18 @@
 //
 
 #include "scene_title.h"
+#include "arena.h"
 #include "atari_text.h"
 #include "color.h"
 #include "drawing.h"
 #include "image.h"
 #include "scene_manager.h"
-#include "array_list.h"
 #include "mesh.h"
 #include "mesh_creation.h"
 #include "shape.h"
 #include "shape_creation.h"
 
 
-// Globals
-array_list_t *title_shapes = NULL;
-
 #define RAD_DEG ((float)M_PI / 180.0f)
 
 
@@ -35,31 +32,40 @@ shape_t *title_tomato(vec2_t position, float scale, float speed) {
 
 void title_init(void) {
 	// Create tomato shapes that rotate
-	title_shapes = array_list_new(16);
+	title_t *title = &scene_context->title;
+	scene_arena = &title->arena;
+	shape_list_init(&title->shapes, &title->arena);
 	const float grid = 0.2f;
 		
-	array_list_add(title_shapes, title_tomato(vec2_make(-3.5f * grid, 0), 0.5f, 5.0f));
-	array_list_add(title_shapes, title_tomato(vec2_make(-2.875f * grid, -1.5f * grid), 1.0f, 10.0f));
-	array_list_add(title_shapes, title_tomato(vec2_make(0.25f * grid, 1.5f * grid), 0.67f, 15.0f));
-	array_list_add(title_shapes, title_tomato(vec2_make(0.5f * grid, -1.25f * grid), 0.75f, 8.0f));
-	array_list_add(title_shapes, title_tomato(vec2_make(3.75f * grid, -1.0f * grid), 1.25f, 9.0f));
+	shape_list_add(&title->shapes, title_tomato(vec2_make(-3.5f * grid, 0), 0.5f, 5.0f));
+	shape_list_add(&title->shapes, title_tomato(vec2_make(-2.875f * grid, -1.5f * grid), 1.0f, 10.0f));
+	shape_list_add(&title->shapes, title_tomato(vec2_make(0.25f * grid, 1.5f * grid), 0.67f, 15.0f));
+	shape_list_add(&title->shapes, title_tomato(vec2_make(0.5f * grid, -1.25f * grid), 0.75f, 8.0f));
+	shape_list_add(&title->shapes, title_tomato(vec2_make(3.75f * grid, -1.0f * grid), 1.25f, 9.0f));
 	
 	// Testing: create shapes being tested
 //	shape_t *s = create_smoke_circle_shape();
 	//s->scale = vec2_make(0.8f, 0.8f);
 	//s->position = vec2_make(0.50f, -0.18f);
-//	array_list_add(title_shapes, s);
+//	shape_list_add(&title_shapes, s);
 //
 //	shape_t *mon = create_monitor_shape();
 //	mon->scale = vec2_make(0.8f, 0.8f);
 //	mon->position = vec2_make(-0.30f, -0.16f);
-//	array_list_add(title_shapes, mon);
+//	shape_list_add(&title_shapes, mon);
+
+	scene_arena = NULL;
+}
 
+void title_free(void) {
+	title_t *title = &scene_context->title;
+	arena_free(&title->arena);
+	shape_list_init(&title->shapes, NULL);
 }
 
 void title_start(void) {
-	shape_t **s = (shape_t **)title_shapes->array;
-	int n = title_shapes->length;
+	shape_t **s = scene_context->title.shapes.array;
+	int n = scene_context->title.shapes.length;
 	for (int i=0; i<n; i++) {
 		scene_add_shape(s[i]);
 	}
@@ -97,7 +103,7 @@ void title_render(void) {
 	draw_shapes();
 
 	// Half-second flasher
-	double t = fmod(scene_lifetime, 1.0);
+	double t = fmod(scene_context->lifetime, 1.0);
 
 	// Draw text
 	
@@ -8,11 +8,21 @@
 #ifndef scene_title_h
 #define scene_title_h
 
+#include "arena.h"
+#include "shape.h"
+
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdint.h>
 
+// Scene objects
+typedef struct {
+	shape_list_t shapes;
+	arena_t arena; // owns the shapes
+} title_t;
+
 void title_init(void);
+void title_free(void);
 void title_start(void);
 bool title_handle_keyboard(SDL_Event event);
 void title_update(double delta_time);
@@ -6,15 +6,20 @@
 //
 
 #include "sequencer.h"
-#include "array_list.h"
 #include "audio_player.h"
 #include "color.h"
+#include "easing.h"
+#include "hot_reload.h"
 #include "mesh.h"
 #include "mesh_creation.h"
+#include "particles.h"
 #include "shape.h"
 #include "shape_creation.h"
+#include "timeline.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #pragma mark - Data
 
@@ -23,54 +28,54 @@
 #define SCALE_FACTOR (0.010f)
 #define ROTATION_FACTOR ((float)M_PI / 180.0f)
 
-// Background color timeline
+// Color tracks. Colors are RGB here, and each sequencer converts a copy to ABGR.
 typedef struct {
 	double t;
-	uint32_t rgb;
-} bg_color_keyframe_t;
-
-bg_color_keyframe_t bg_color_timeline[] = {
-	{ .t = 0, .rgb = COLOR_RGB_BLACK },
-	{ .t = 0.5, .rgb = COLOR_RGB_YELLOW_2 },
-	{ .t = 41.6, .rgb = COLOR_RGB_YELLOW_2 },
-	{ .t = 42.1, .rgb = COLOR_RGB_WHITE },
-	{ .t = 42.6, .rgb = COLOR_RGB_WHITE },
-	{ .t = 44.1, .rgb = COLOR_RGB_BLACK },
-	{ .t = 73.6, .rgb = COLOR_RGB_BLACK },
-	{ .t = 74.1, .rgb = COLOR_RGB_YELLOW_2 },
-	{ .t = SONG_DURATION - 1.0, .rgb = COLOR_RGB_YELLOW_2 },
-	{ .t = SONG_DURATION, .rgb = COLOR_RGB_BLACK },
-	{ .t = INFINITY, .rgb = COLOR_RGB_BLACK }
-};
+	uint32_t color;
+	double scale; // 255 / length of the segment starting here
+} seq_color_keyframe_t;
 
-// Sequencer operations
+typedef struct {
+	seq_color_keyframe_t *keyframes;
+	int count;
+	double period; // repeats every period seconds, or 0 to hold the last color
+	int cursor; // keyframe ending the segment found last
+} seq_color_track_t;
+
+const seq_color_keyframe_t seq_bg_colors[] = {
+	{ .t = 0, .color = COLOR_RGB_BLACK },
+	{ .t = 0.5, .color = COLOR_RGB_YELLOW_2 },
+	{ .t = 41.6, .color = COLOR_RGB_YELLOW_2 },
+	{ .t = 42.1, .color = COLOR_RGB_WHITE },
+	{ .t = 42.6, .color = COLOR_RGB_WHITE },
+	{ .t = 44.1, .color = COLOR_RGB_BLACK },
+	{ .t = 73.6, .color = COLOR_RGB_BLACK },
+	{ .t = 74.1, .color = COLOR_RGB_YELLOW_2 },
+	{ .t = SONG_DURATION - 1.0, .color = COLOR_RGB_YELLOW_2 },
+	{ .t = SONG_DURATION, .color = COLOR_RGB_BLACK },
+	{ .t = INFINITY, .color = COLOR_RGB_BLACK }
+};
 
-typedef enum : uint32_t {
-	EndSequence,
-
-	ShowShape, 		// .p0: position (x, y), .p1:  rotation (.x: angle)
-	ShowMesh, 		// .p0: position, .p1: rotation
-	SetShapeOpacity, // .p0.x, .p1.x: opacity
-	SetMeshOpacity, // .p0.x, .p1.x: opacity
-
-	MoveShape, 		// .p0: starting position, .p1: ending position (in percent)
-	MoveMesh, 		// .p0: starting position, .p1: ending position
-	RotateShape, 	// .p0: starting rotation, .p1: ending rotation (in degrees)
-	RotateMesh, 	// .p0: starting rotation, .p1: ending rotation
-	ScaleShape,  	// .p0: starting scale, .p1: ending scale (in percent)
-	ScaleMesh, 		// .p0: starting scale, .p1: ending scale
-} event_commands;
-
-typedef enum: uint32_t {
-	EaseLinear,
-	EaseInQuad,
-	EaseOutQuad,
-	EaseInCubic,
-	EaseOutCubic,
-	EaseOutBounce,
-	EaseOutElastic,
-	EaseBezier,
-} easing_curve;
+// UFO hue cycling, one turn around the color wheel every 6 seconds
+const seq_color_keyframe_t seq_ufo_line_colors[] = {
+	{ .t = 0, .color = 0x7F0000 },
+	{ .t = 1, .color = 0x7F7F00 },
+	{ .t = 2, .color = 0x007F00 },
+	{ .t = 3, .color = 0x007F7F },
+	{ .t = 4, .color = 0x00007F },
+	{ .t = 5, .color = 0x7F007F },
+	{ .t = 6, .color = 0x7F0000 },
+};
+const seq_color_keyframe_t seq_ufo_point_colors[] = {
+	{ .t = 0, .color = 0xFF0000 },
+	{ .t = 1, .color = 0xFFFF00 },
+	{ .t = 2, .color = 0x00FF00 },
+	{ .t = 3, .color = 0x00FFFF },
+	{ .t = 4, .color = 0x0000FF },
+	{ .t = 5, .color = 0xFF00FF },
+	{ .t = 6, .color = 0xFF0000 },
+};
+#define UFO_POINT_HUE_OFFSET (1.5) // seconds, 90 degrees ahead of the lines
 
 typedef enum : uint32_t {
 	Numeral_1_Mesh = 0,
@@ -111,321 +116,175 @@ typedef enum : uint32_t {
 
 } seq_shape_index;
 
+typedef enum : uint32_t {
+	Firework_Sparks_1_Emitter = 0,
+	Firework_Sparks_2_Emitter,
+	Smoke_Emitter,
+} seq_emitter_index;
+
+// Names used by timeline files, in the same order as the indexes above
+const char *const seq_mesh_names[] = {
+	"Numeral_1_Mesh",
+	"Numeral_2_Mesh",
+	"Numeral_3_Mesh",
+	"Numeral_4_Mesh",
+	"Grid_Mesh",
+	"Mtn_1_Mesh",
+	"Mtn_2_Mesh",
+	"Mtn_3_Mesh",
+	"Mtn_4_Mesh",
+	"Mtn_5_Mesh",
+	"Radio_Tower_Mesh",
+	"Fireworks_1_Mesh",
+	"Fireworks_2_Mesh",
+	"UFO_Mesh",
+	"Ball_Mesh",
+	"Cone_1_Mesh",
+	"Cone_2_Mesh",
+};
+
+const char *const seq_shape_names[] = {
+	"Studio_Bkgnd_Shape",
+	"Moon_Shape",
+	"Heart_Shape",
+	"Star_Shape",
+	"Envelope_Shape",
+	"Monitor_Shape",
+	"Smoke_1_Shape",
+	"Smoke_2_Shape",
+	"Smoke_3_Shape",
+	"CPU_Shape",
+	"Microphone_Shape",
+	"Smoke_4_Shape",
+	"Zap_1_Shape",
+	"Zap_2_Shape",
+	"Explosion_Shape",
+};
+
+const char *const seq_emitter_names[] = {
+	"Firework_Sparks_1_Emitter",
+	"Firework_Sparks_2_Emitter",
+	"Smoke_Emitter",
+};
+
+#define SEQ_ARRAY_COUNT(names) ((int)(sizeof(names) / sizeof(names[0])))
+const timeline_targets_t seq_targets = {
+	seq_mesh_names, SEQ_ARRAY_COUNT(seq_mesh_names),
+	seq_shape_names, SEQ_ARRAY_COUNT(seq_shape_names),
+	seq_emitter_names, SEQ_ARRAY_COUNT(seq_emitter_names),
+};
+
+// Colors are RGB here, and each sequencer converts a copy to ABGR
+const particle_emitter_t seq_emitters[] = {
+	{ .count = 2000, .speed = 1.5f, .speed_variation = 0.25f, .lifetime = 2.0f, .lifetime_variation = 0.5f, .gravity = 0.1f, .color = COLOR_RGB_GREEN_2, .style = PARTICLE_STREAK },
+	{ .count = 2000, .speed = 1.5f, .speed_variation = 0.25f, .lifetime = 2.0f, .lifetime_variation = 0.5f, .gravity = 0.1f, .color = COLOR_RGB_YELLOW_1, .style = PARTICLE_PIXEL },
+	{ .count = 150, .speed = 0.25f, .speed_variation = 0.5f, .lifetime = 2.5f, .lifetime_variation = 0.3f, .gravity = -0.05f, .color = COLOR_RGB_GRAY_80, .style = PARTICLE_ROUND_POINT },
+};
+#define SEQ_EMITTER_COUNT ((int)(sizeof(seq_emitters) / sizeof(seq_emitters[0])))
+
+// Played instead of a timeline that fails to load
+const sequence_event seq_no_events[] = { { .cmd = EndSequence } };
+
+// The show's events compiled into queues ordered by time, so each update only visits the
+// events that start or end within the time period, and those in progress.
+typedef struct {
+	int event_count;
+	int *start_order; // event indexes sorted by t0
+	int *end_order; // event indexes sorted by t1
+	int start_cursor; // number of events in start_order that have started
+	int end_cursor; // number of events in end_order that have ended
+	double time; // time the cursors and active set correspond to
+	int *active; // indexes of started events that haven't ended, in table order
+	int active_count;
+	int *changed; // scratch space for events starting or ending in one update
+	
+	// Interval index for seeking. Each bucket of time lists the events whose
+	// intervals overlap it, in table order. The first and last buckets extend
+	// to the start and end of time.
+	double bucket_origin;
+	double bucket_time;
+	int bucket_count;
+	int *bucket_starts; // bucket_count + 1 offsets into bucket_events
+	int *bucket_events;
+} sequencer_queue_t;
+
+#define SEQ_MIN_BUCKET_TIME (0.5) // seconds
+#define SEQ_MAX_BUCKETS (1024)
+
+// Events baked into one curve per object property. Each track lists the segments
+// that write to the property, so both playback and seeking evaluate the property
+// once from whichever segment wrote it last.
+typedef enum : uint32_t {
+	PropertyVisible,
+	PropertyPosition,
+	PropertyRotation,
+	PropertyScale,
+	PropertyOpacity,
+	PropertyCount
+} seq_property;
+
+typedef enum : uint32_t {
+	PhaseStart,
+	PhaseUpdate,
+	PhaseEnd,
+} seq_phase;
+
 typedef struct {
-	event_commands cmd;
-	uint32_t target;
+	double t0; // first time the event writes the property
+	double t1; // last time it writes the property, same as t0 for a single change
+	double latest_t1; // largest t1 of this and the earlier keyframes in the track
+	vec3_t from; // value at t0, in timeline units
+	vec3_t to; // value at t1
 	easing_curve ease;
-	double t0;
-	double t1;
-	vec3_t p0;
-	vec3_t p1;
-} sequence_event;
-
-sequence_event seq_events[] = {
-	// 1 2 4 2
-	{ ShowMesh, Numeral_1_Mesh, .t0 = 0.5, .t1 = 7.0, .p0 = {-300, -100, 0}, .p1 = {0, 0, 0} },
-	{ ShowMesh, Numeral_2_Mesh, .t0 = 1.0, .t1 = 7.0, .p0 = {-100, 0, 0}, .p1 = {0, 0, 0} },
-	{ ShowMesh, Numeral_3_Mesh, .t0 = 1.5, .t1 = 7.0, .p0 = {100, 100, 0}, .p1 = {0, 0, 0} },
-	{ ShowMesh, Numeral_4_Mesh, .t0 = 2.0, .t1 = 7.0, .p0 = {300, 0, 0}, .p1 = {0, 0, 0} },
-	{ RotateMesh, Numeral_1_Mesh, EaseLinear, .t0 = 0.5, .t1 = 0.75, .p0 = {0, 135, 0}, .p1 = {0, 0, 0} },
-	{ RotateMesh, Numeral_2_Mesh, EaseLinear, .t0 = 1.0, .t1 = 1.25, .p0 = {0, 135, 0}, .p1 = {0, 0, 0} },
-	{ RotateMesh, Numeral_3_Mesh, EaseLinear, .t0 = 1.5, .t1 = 1.75, .p0 = {0, 135, 0}, .p1 = {0, 0, 0} },
-	{ RotateMesh, Numeral_4_Mesh, EaseLinear, .t0 = 2.0, .t1 = 2.25, .p0 = {0, 135, 0}, .p1 = {0, 0, 0} },
-	{ MoveMesh, Numeral_1_Mesh, EaseBezier, .t0 = 2.5, .t1 = 4.5, .p0 = {-300, -100, 0}, .p1 = {-300, 400, 0} },
-	{ MoveMesh, Numeral_2_Mesh, EaseBezier, .t0 = 2.5, .t1 = 4.5, .p0 = {-100, 0, 0}, .p1 = {-100, 500, 0} },
-	{ MoveMesh, Numeral_3_Mesh, EaseBezier, .t0 = 2.5, .t1 = 4.5, .p0 = {100, 100, 0}, .p1 = {100, 600, 0} },
-	{ MoveMesh, Numeral_4_Mesh, EaseBezier, .t0 = 2.5, .t1 = 4.5, .p0 = {300, 0, 0}, .p1 = {300, 500, 0} },
-	
-#define T_END (42.1)
-	// 2D Studio
-#define T0 (2.5)
-	{ ShowShape, Studio_Bkgnd_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,-80,0}, .p1 = {0,0,0} },
-	{ MoveShape, Studio_Bkgnd_Shape, EaseBezier, .t0 = T0, .t1 = T0+4.2, .p0 = {0,-80,0}, .p1 = {0,15,0} },
-#undef T0
-	
-	// Moon
-#define T0 (6.6)
-	{ ShowShape, Moon_Shape, .t0 = T0-2, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Moon_Shape, EaseOutElastic, .t0 = T0-2, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {33,33,0} },
-	{ RotateShape, Moon_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {405,0,0} },
-	{ ScaleShape, Moon_Shape, EaseBezier, .t0 = T0+2, .t1 = T0+4, .p0 = {33,33,0}, .p1 = {12,12,0} },
-	{ MoveShape, Moon_Shape, EaseBezier, .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {0,18,0} },
-#undef T0
-	
-	// Heart
-#define T0 (10.6)
-	{ ShowShape, Heart_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Heart_Shape, EaseOutElastic, .t0 = T0, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {50,50,0} },
-	{ RotateShape, Heart_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {-380,0,0} },
-	{ ScaleShape, Heart_Shape, EaseBezier, .t0 = T0+2, .t1 = T0+4, .p0 = {50,50,0}, .p1 = {18,18,0} },
-	{ MoveShape, Heart_Shape, EaseBezier, .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {-50,20,0} },
-#undef T0
-
-	// Star
-#define T0 (14.6)
-	{ ShowShape, Star_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Star_Shape, EaseOutElastic, .t0 = T0, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {35,35,0} },
-	{ RotateShape, Star_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {542,0,0} },
-	{ ScaleShape, Star_Shape, EaseBezier,  .t0 = T0+2, .t1 = T0+4, .p0 = {35,35,0}, .p1 = {10,10,0} },
-	{ MoveShape, Star_Shape, EaseBezier,   .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {50,20,0} },
-#undef T0
-
-	// Microphone with stand
-#define T0 (18.6)
-	{ ShowShape, Microphone_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Microphone_Shape, EaseOutElastic, .t0 = T0, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {35,35,0} },
-	{ RotateShape, Microphone_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {-360,0,0} },
-	{ ScaleShape, Microphone_Shape, EaseBezier,  .t0 = T0+2, .t1 = T0+4, .p0 = {35,35,0}, .p1 = {18,18,0} },
-	{ MoveShape, Microphone_Shape, EaseBezier,   .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {15,-23.5,0} },
-#undef T0
-	// Monitor
-#define T0 (22.6)
-	{ ShowShape, Monitor_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Monitor_Shape, EaseOutElastic, .t0 = T0, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {100,100,0} },
-	{ RotateShape, Monitor_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {360,0,0} },
-	{ ScaleShape, Monitor_Shape, EaseBezier,  .t0 = T0+2, .t1 = T0+4, .p0 = {100,100,0}, .p1 = {80,80,0} },
-	{ MoveShape, Monitor_Shape, EaseBezier,   .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {-30,-17,0} },
-#undef T0
-	
-	// CPU
-#define T0 (26.6)
-	{ ShowShape, CPU_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleShape, CPU_Shape, EaseOutElastic, .t0 = T0, .t1 = T0+1.25, .p0 = {0,0,0}, .p1 = {100,100,0} },
-	{ RotateShape, CPU_Shape, EaseBezier, .t0 = T0+1, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {-360,0,0} },
-	{ ScaleShape, CPU_Shape, EaseBezier,  .t0 = T0+2, .t1 = T0+4, .p0 = {100,100,0}, .p1 = {80,80,0} },
-	{ MoveShape, CPU_Shape, EaseBezier,   .t0 = T0+3, .t1 = T0+4, .p0 = {0,0,0}, .p1 = {50,-19.5,0} },
-#undef T0
-	
-	// Zap
-#define T0 (30.6)
-	{ ShowShape, Zap_1_Shape, .t0 = T0, .t1 = T0+0.5, .p0 = {-30,-17,0}, .p1 = {0,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+1, .t1 = T0+1.5, .p0 = {-20,-12,0}, .p1 = {-22,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+2, .t1 = T0+2.5, .p0 = {-40,-15,0}, .p1 = {25,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+3, .t1 = T0+3.5, .p0 = {-30,-17,0}, .p1 = {-45,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+4, .t1 = T0+4.5, .p0 = {-30,-17,0}, .p1 = {0,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+5, .t1 = T0+5.5, .p0 = {-20,-12,0}, .p1 = {-22,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+6, .t1 = T0+6.5, .p0 = {-30,-17,0}, .p1 = {0,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+7, .t1 = T0+7.5, .p0 = {-40,-12,0}, .p1 = {22,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+8, .t1 = T0+8.5, .p0 = {-30,-17,0}, .p1 = {-22,0,0} },
-	{ ShowShape, Zap_1_Shape, .t0 = T0+9, .t1 = T0+9.5, .p0 = {-40,-12,0}, .p1 = {45,0,0} },
-
-	{ ShowShape, Zap_2_Shape, .t0 = T0+0.75, .t1 = T0+1.25, .p0 = {45,7,0}, .p1 = {22,0,0} },
-	{ ShowShape, Zap_2_Shape, .t0 = T0+1.75, .t1 = T0+2.25, .p0 = {55,12,0}, .p1 = {-22,0,0} },
-#undef T0
-
-	// Smoke
-	{ ShowShape, Smoke_1_Shape, 			.t0 = 31.6, .t1 = T_END, .p0 = {50,-25,0}, .p1 = {0,0,0} },
-	{ ShowShape, Smoke_2_Shape, 			.t0 = 32.6, .t1 = T_END, .p0 = {45,-25,0}, .p1 = {10,0,0} },
-	{ ShowShape, Smoke_3_Shape, 			.t0 = 33.6, .t1 = T_END, .p0 = {55,-25,0}, .p1 = {-10,0,0} },
-
-	{ MoveShape, Smoke_1_Shape, EaseInQuad, .t0 = 31.6, .t1 = 33.6, .p0 = {50,-25,0}, .p1 = {50,55,0} },
-	{ ScaleShape, Smoke_1_Shape, EaseOutQuad, .t0 = 31.6, .t1 = 33.6, .p0 = {80,80,0}, .p1 = {160,160,0} },
-	{ MoveShape, Smoke_2_Shape, EaseInQuad, .t0 = 32.6, .t1 = 34.6, .p0 = {45,-25,0}, .p1 = {40,55,0} },
-	{ ScaleShape, Smoke_2_Shape, EaseOutQuad, .t0 = 32.6, .t1 = 34.6, .p0 = {80,80,0}, .p1 = {160,160,0} },
-	{ MoveShape, Smoke_3_Shape, EaseInQuad, .t0 = 33.6, .t1 = 35.6, .p0 = {55,-25,0}, .p1 = {60,55,0} },
-	{ ScaleShape, Smoke_3_Shape, EaseOutQuad, .t0 = 33.6, .t1 = 35.6, .p0 = {80,80,0}, .p1 = {160,160,0} },
-
-	{ ShowShape, Smoke_4_Shape, 			.t0 = 35.6, .t1 = T_END, .p0 = {50,-15,0}, .p1 = {0,0,0} },
-
-	{ MoveShape, Smoke_1_Shape, EaseInQuad, .t0 = 34.1, .t1 = 36.0, .p0 = {50,-15,0}, .p1 = {50,50,0} },
-	{ ScaleShape, Smoke_1_Shape, EaseOutQuad, .t0 = 34.1, .t1 = 36.0, .p0 = {120,120,0}, .p1 = {240,240,0} },
-	{ MoveShape, Smoke_2_Shape, EaseInQuad, .t0 = 34.6, .t1 = 36.5, .p0 = {40,-15,0}, .p1 = {20,50,0} },
-	{ ScaleShape, Smoke_2_Shape, EaseOutQuad, .t0 = 34.6, .t1 = 36.5, .p0 = {120,120,0}, .p1 = {240,240,0} },
-	{ MoveShape, Smoke_3_Shape, EaseInQuad, .t0 = 35.1, .t1 = 37.0, .p0 = {60,-15,0}, .p1 = {80,50,0} },
-	{ ScaleShape, Smoke_3_Shape, EaseOutQuad, .t0 = 35.1, .t1 = 37.0, .p0 = {120,120,0}, .p1 = {240,240,0} },
-	{ MoveShape, Smoke_4_Shape, EaseInQuad, .t0 = 35.6, .t1 = 37.5, .p0 = {50,-15,0}, .p1 = {40,50,0} },
-	{ ScaleShape, Smoke_4_Shape, EaseOutQuad, .t0 = 35.6, .t1 = 37.5, .p0 = {120,120,0}, .p1 = {240,240,0} },
-
-	{ MoveShape, Smoke_1_Shape, EaseInQuad, .t0 = 36.1, .t1 = T_END, .p0 = {40,-15,0}, .p1 = {50,50,0} },
-	{ ScaleShape, Smoke_1_Shape, EaseOutQuad, .t0 = 36.1, .t1 = T_END, .p0 = {160,160,0}, .p1 = {320,320,0} },
-	{ MoveShape, Smoke_2_Shape, EaseInQuad, .t0 = 36.6, .t1 = T_END, .p0 = {30,-15,0}, .p1 = {20,50,0} },
-	{ ScaleShape, Smoke_2_Shape, EaseOutQuad, .t0 = 36.6, .t1 = T_END, .p0 = {160,160,0}, .p1 = {320,320,0} },
-	{ MoveShape, Smoke_3_Shape, EaseInQuad, .t0 = 37.1, .t1 = T_END, .p0 = {50,-15,0}, .p1 = {80,50,0} },
-	{ ScaleShape, Smoke_3_Shape, EaseOutQuad, .t0 = 37.1, .t1 = T_END, .p0 = {160,160,0}, .p1 = {320,320,0} },
-	{ MoveShape, Smoke_4_Shape, EaseInQuad, .t0 = 37.6, .t1 = T_END, .p0 = {0,-15,0}, .p1 = {-20,50,0} },
-	{ ScaleShape, Smoke_4_Shape, EaseOutQuad, .t0 = 37.6, .t1 = T_END, .p0 = {160,160,0}, .p1 = {320,320,0} },
-
-	// Explosion
-	{ ShowShape, Explosion_Shape, 				.t0 = T_END-0.5, .t1 = T_END+0.25, .p0 = {50,-19,0}, .p1 = {0,0,0} },
-	{ ScaleShape, Explosion_Shape, EaseOutQuad, .t0 = T_END-0.5, .t1 = T_END, .p0 = {1,1,1}, .p1 = {200, 200,0} },
-#undef T_END
-	
-	// -- 3D; Chorus --
-	// Grid
-#define T0 (43.1)
-	{ ShowMesh, Grid_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, Grid_Mesh, 			.t0 = T0, .t1 = T0, .p0 = {400,400,400}, .p1 = {400,400,400} },
-	{ SetMeshOpacity, Grid_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ RotateMesh, Grid_Mesh, EaseOutBounce, .t0 = T0+1, .t1 = T0+5, .p0 = {0,0,0}, .p1 = {90,0,0} },
-	{ MoveMesh, Grid_Mesh, EaseOutBounce, .t0 = T0+1, .t1 = T0+5, .p0 = {0,0,0}, .p1 = {0,-100,100} },
-	
-	// Mtn 1
-#undef T0
-#define T0 (47.1)
-	{ ShowMesh, Mtn_1_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {75,-100,650}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Mtn_1_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Mtn_1_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {200,1,100}, .p1 = {200,1,100} },
-	{ ScaleMesh, Mtn_1_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {200,1,100}, .p1 = {200,200,100} },
-	
-	// Mtn 2
-#undef T0
-#define T0 (48.1)
-	{ ShowMesh, Mtn_2_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {-300,-100,650}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Mtn_2_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Mtn_2_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {200,1,100}, .p1 = {200,1,100} },
-	{ ScaleMesh, Mtn_2_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {200,1,100}, .p1 = {200,125,100} },
-	
-	// Mtn 3
-#undef T0
-#define T0 (49.1)
-	{ ShowMesh, Mtn_3_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {350,-100,650}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Mtn_3_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Mtn_3_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {100,1,100}, .p1 = {100,1,100} },
-	{ ScaleMesh, Mtn_3_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {100,1,100}, .p1 = {100,75,100} },
-	
-	// Mtn 4
-#undef T0
-#define T0 (50.1)
-	{ ShowMesh, Mtn_4_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {550,-100,400}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Mtn_4_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Mtn_4_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {100,1,200}, .p1 = {100,1,200} },
-	{ ScaleMesh, Mtn_4_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {100,1,200}, .p1 = {100,75,200} },
-	
-	// Mtn 5
-#undef T0
-#define T0 (51.1)
-	{ ShowMesh, Mtn_5_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {-550,-100,350}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Mtn_5_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Mtn_5_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {100,1,300}, .p1 = {100,1,300} },
-	{ ScaleMesh, Mtn_5_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {100,1,300}, .p1 = {100,75,300} },
-	
-	// Radio Tower
-#undef T0
-#define T0 (52.1)
-	{ ShowMesh, Radio_Tower_Mesh, 				.t0 = T0, .t1 = 73.6, .p0 = {-200,-100,100}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Radio_Tower_Mesh, EaseBezier, .t0 = T0, .t1 = T0+1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ ScaleMesh, Radio_Tower_Mesh, 				.t0 = T0, .t1 = T0, .p0 = {12,1,12}, .p1 = {12,1,12} },
-	{ ScaleMesh, Radio_Tower_Mesh, EaseOutElastic, .t0 = T0+0.5, .t1 = T0+2, .p0 = {12,1,12}, .p1 = {12,200,12} },
-	
-	// Fireworks
-#undef T0
-#define S0 (2)
-#define S1 (200)
-#define M1 Fireworks_1_Mesh
-#define M2 Fireworks_2_Mesh
-
-#define T0 (54.1)
-	{ ShowMesh, M1, 		.t0 = T0, .t1 = 73.6, .p0 = {200,100,100}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M1, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M1, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-#define T0 (56.1)
-	{ ShowMesh, M2, 		.t0 = T0, .t1 = 73.6, .p0 = {-350,80,200}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M2, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M2, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-#define T0 (58.1)
-	{ ShowMesh, M1, 		.t0 = T0, .t1 = 73.6, .p0 = {350,104,150}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M1, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M1, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-#define T0 (58.5)
-	{ ShowMesh, M2, 		.t0 = T0, .t1 = 73.6, .p0 = {-200,80,120}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M2, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M2, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-#define T0 (59.0)
-	{ ShowMesh, M1, 		.t0 = T0, .t1 = 73.6, .p0 = {0,100,120}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M1, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M1, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-#define T0 (59.5)
-	{ ShowMesh, M2, 		.t0 = T0, .t1 = 73.6, .p0 = {200,120,120}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, M2, 	.t0 = T0, .t1 = T0+2, .p0 = {0.5,0,0}, .p1 = {0,0,0} },
-	{ ScaleMesh, M2, EaseOutCubic, .t0 = T0, .t1 = T0+2, .p0 = {S0,S0,S0}, .p1 = {S1,S1,S1} },
-#undef T0
-
-#undef S0
-#undef S1
-#undef M1
-#undef M2
-	// End Fireworks
-	
-	// UFO
-#define M1 UFO_Mesh
-#define T0 (59.0)
-	{ ShowMesh, M1, 		.t0 = T0, .t1 = 73.6, .p0 = {600,200,200}, .p1 = {0,0,30} },
-	{ ScaleMesh, M1, EaseBezier, .t0 = T0, .t1 = T0, .p0 = {100,100,100}, .p1 = {100,100,100} },
-	{ MoveMesh, M1, EaseBezier, .t0 = T0, .t1 = T0+4, .p0 = {600,200,200}, .p1 = {-200,200,100} },
-	{ RotateMesh, M1, EaseBezier, .t0 = T0, .t1 = T0+4, .p0 = {0,0,30}, .p1 = {0,0,-30} },
-	{ MoveMesh, M1, EaseBezier, .t0 = T0+4, .t1 = T0+6, .p0 = {-200,200,100}, .p1 = {-200,125,100} },
-	{ RotateMesh, M1, EaseBezier, .t0 = T0+4, .t1 = T0+6, .p0 = {0,0,-30}, .p1 = {0,0,0} },
-	{ MoveMesh, M1, EaseBezier, .t0 = T0+6, .t1 = T0+8, .p0 = {-200,125,100}, .p1 = {-100,225,25} },
-	{ RotateMesh, M1, EaseBezier, .t0 = T0+6, .t1 = T0+8, .p0 = {0,0,0}, .p1 = {-60,0,0} },
-	{ MoveMesh, M1, EaseBezier, .t0 = T0+8, .t1 = T0+10, .p0 = {-100,225,25}, .p1 = {0,25,4} },
-	{ RotateMesh, M1, EaseBezier, .t0 = T0+8, .t1 = T0+10, .p0 = {-60,0,0}, .p1 = {0,0,0} },
-	{ MoveMesh, M1, EaseBezier, .t0 = T0+11, .t1 = 73.6, .p0 = {0,25,4}, .p1 = {0,0,-200} },
-	{ RotateMesh, M1, EaseBezier, .t0 = T0+11, .t1 = 73.6, .p0 = {0,0,0}, .p1 = {-90,0,0} },
-	{ ScaleMesh, M1, EaseBezier, .t0 = T0+8, .t1 = 73.6, .p0 = {100,100,100}, .p1 = {200,200,200} },
-
-#undef T0
-#undef M1
-	// End UFO
-	
-	// -- 2D; Verse --
-	// SONG_DURATION
-	
-	// Restore part of previous verse scene
-#define T0 (74.1)
-#define T1 (T0+1)
-#define T_END (SONG_DURATION)
-	{ ShowShape, Studio_Bkgnd_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,15,0}, .p1 = {0,0,0} },
-	{ ShowShape, Moon_Shape, .t0 = T0, .t1 = T_END, .p0 = {0,18,0}, .p1 = {0,0,0} },
-	{ ShowShape, Heart_Shape, .t0 = T0, .t1 = T_END, .p0 = {-50,20,0}, .p1 = {0,0,0} },
-	{ ShowShape, Star_Shape, .t0 = T0, .t1 = T_END, .p0 = {50,20,0}, .p1 = {0,0,0} },
-	// Fade In
-	{ SetShapeOpacity, Studio_Bkgnd_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ SetShapeOpacity, Moon_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ SetShapeOpacity, Heart_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-	{ SetShapeOpacity, Star_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {0,0,0}, .p1 = {1,0,0} },
-
-#undef T0
-#undef T1
-
-	// Drop a 3D ball
-#define T0 (75.1)
-	{ ShowMesh, Ball_Mesh, .t0 = T0, .t1 = T_END, .p0 = {0,400,-100}, .p1 = {0,0,0} },
-	{ MoveMesh, Ball_Mesh, EaseOutBounce, .t0 = T0, .t1 = T0+4, .p0 = {0,400,-100}, .p1 = {0,50,-150} },
-#undef T0
-
-	// Drop traffic cone 1
-#define T0 (77.1)
-	{ ShowMesh, Cone_1_Mesh, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ MoveMesh, Cone_1_Mesh, EaseOutBounce, .t0 = T0, .t1 = T0+4, .p0 = {-300,400,150}, .p1 = {-300,-200,150} },
-#undef T0
-
-	// Drop traffic cone 2
-#define T0 (78.1)
-	{ ShowMesh, Cone_2_Mesh, .t0 = T0, .t1 = T_END, .p0 = {0,0,0}, .p1 = {0,0,0} },
-	{ MoveMesh, Cone_2_Mesh, EaseOutBounce, .t0 = T0, .t1 = T0+4, .p0 = {300,400,150}, .p1 = {300,-200,150} },
-#undef T0
-
-	// Fade Out
-#define T0 (SONG_DURATION - 1.0)
-#define T1 (SONG_DURATION)
-	{ SetShapeOpacity, Studio_Bkgnd_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {1,0,0} },
-	{ SetShapeOpacity, Moon_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-	{ SetShapeOpacity, Heart_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-	{ SetShapeOpacity, Star_Shape, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Ball_Mesh, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Cone_1_Mesh, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-	{ SetMeshOpacity, Cone_2_Mesh, EaseBezier, .t0 = T0, .t1 = T1, .p0 = {1,0,0}, .p1 = {0,0,0} },
-
-#undef T0
-#undef T1
-#undef T_END
-
-	{ .cmd = EndSequence }
+	int event;
+	seq_phase phase; // order of writes within one update
+} seq_keyframe_t;
+
+typedef struct {
+	vec3_t position;
+	vec3_t rotation; // .x only for shapes
+	vec3_t scale;
+} seq_initial_state_t;
+
+typedef struct {
+	int mesh_count;
+	int shape_count;
+	int track_count; // (mesh_count + shape_count) * PropertyCount
+	int *track_starts; // index of each track's first keyframe, plus the end of the last track
+	seq_keyframe_t *keyframes; // sorted by track, then time and order of writes
+	int *cursors; // per track, index of the first keyframe after the last update's time
+	int *dirty; // tracks written to in the current update
+	int dirty_count;
+	bool *is_dirty;
+	const seq_keyframe_t **found; // per dirty track, the keyframe that writes it
+	easing_curve *eases; // per dirty track
+	float *progress; // per dirty track, eased in one batch
+} sequencer_tracks_t;
+
+// Everything one gameplay scene plays the show with. Scenes on different threads
+// each have their own, and only share the show's timeline, which they just read.
+struct sequencer_s {
+	const sequence_event *events; // from the timeline
+	const easing_bezier_t *curves;
+	int curve_count;
+	const beat_segment_t *segments;
+	int segment_count;
+	int beats_per_bar;
+	
+	// Owns the queue, tracks and beat map, which are replaced together when the timeline is reloaded
+	arena_t arena;
+	sequencer_queue_t queue;
+	sequencer_tracks_t tracks;
+	beat_map_t beat_map; // tempo of the song, from the timeline
+	seq_initial_state_t *initial_states; // meshes, then shapes
+	
+	seq_color_keyframe_t bg_color_keyframes[SEQ_ARRAY_COUNT(seq_bg_colors)];
+	seq_color_keyframe_t ufo_line_keyframes[SEQ_ARRAY_COUNT(seq_ufo_line_colors)];
+	seq_color_keyframe_t ufo_point_keyframes[SEQ_ARRAY_COUNT(seq_ufo_point_colors)];
+	seq_color_track_t bg_color_track;
+	seq_color_track_t ufo_line_track;
+	seq_color_track_t ufo_point_track;
+	particle_emitter_t emitters[SEQ_EMITTER_COUNT];
 };
 
 #pragma mark - Functions
@@ -434,10 +293,442 @@ void add_numeral_mesh(gameplay_t *scene, char c) {
 	mesh_t *mesh;
 	mesh = mesh_create_3d_character(c);
 	mesh_set_children_color(mesh, rgb_to_abgr(COLOR_RGB_RED_1), 0);
-	array_list_add(scene->meshes, mesh);
+	mesh_list_add(&scene->meshes, mesh);
+}
+
+void seq_color_track_init(seq_color_track_t *track, seq_color_keyframe_t *keyframes, const seq_color_keyframe_t *colors, int count, uint8_t alpha, double period) {
+	for (int i = 0; i < count; i++) {
+		keyframes[i] = colors[i];
+		keyframes[i].color = rgba_to_abgr(colors[i].color, alpha);
+		double length = (i + 1 < count)? colors[i + 1].t - colors[i].t : 0.0;
+		keyframes[i].scale = (length > 0.0)? 255.0 / length : 0.0;
+	}
+	*track = (seq_color_track_t){ keyframes, count, period, 1 };
+}
+
+uint32_t seq_color_track_at(seq_color_track_t *track, double time) {
+	const seq_color_keyframe_t *k = track->keyframes;
+	const int last = track->count - 1;
+	if (track->period > 0.0) {
+		time -= floor(time / track->period) * track->period;
+	}
+	if (time <= k[0].t) return k[0].color;
+	if (time > k[last].t) return k[last].color;
+	
+	// Find the segment from keyframe i - 1 to i containing the time. The cursor
+	// only moves forward during playback, so it is searched for after going back.
+	int i = track->cursor;
+	if (k[i - 1].t >= time) {
+		int low = 1, high = last;
+		while (low < high) {
+			int mid = (low + high) / 2;
+			if (k[mid].t < time) low = mid + 1; else high = mid;
+		}
+		i = low;
+	}
+	while (k[i].t < time) {
+		i++;
+	}
+	track->cursor = i;
+	
+	uint32_t w = (uint32_t)((time - k[i - 1].t) * k[i - 1].scale + 0.5);
+	return color_interpolate(k[i - 1].color, k[i].color, w);
+}
+
+void sequencer_update_colors(gameplay_t *scene, double current_time) {
+	sequencer_t *seq = scene->sequencer;
+	scene->bg_color = seq_color_track_at(&seq->bg_color_track, current_time);
+	
+	// Color cycling for UFO
+	uint32_t line_color = seq_color_track_at(&seq->ufo_line_track, current_time);
+	uint32_t point_color = seq_color_track_at(&seq->ufo_point_track, current_time + UFO_POINT_HUE_OFFSET);
+	mesh_set_children_color(scene->meshes.array[UFO_Mesh], line_color, point_color);
+}
+
+typedef struct {
+	double t;
+	int event;
+} seq_event_time_t;
+
+int seq_compare_event_times(const void *a, const void *b) {
+	// Order by time, then by position in the events
+	const seq_event_time_t *x = a;
+	const seq_event_time_t *y = b;
+	if (x->t != y->t) return x->t < y->t? -1 : 1;
+	return x->event - y->event;
+}
+
+bool seq_sort_events(int *order, const sequence_event *events, int n, bool by_end) {
+	// Event indexes ordered by t0, or by t1 if by_end is set
+	arena_mark_t mark = arena_mark(&frame_arena);
+	seq_event_time_t *times = arena_alloc(&frame_arena, sizeof(seq_event_time_t) * (size_t)(n + 1));
+	if (!times) return false;
+	for (int i = 0; i < n; i++) {
+		times[i] = (seq_event_time_t){ by_end? events[i].t1 : events[i].t0, i };
+	}
+	qsort(times, n, sizeof(seq_event_time_t), seq_compare_event_times);
+	for (int i = 0; i < n; i++) {
+		order[i] = times[i].event;
+	}
+	arena_restore(&frame_arena, mark);
+	return true;
+}
+
+int seq_track_search(const sequencer_tracks_t *tr, int track, double time) {
+	// Index of the track's first keyframe after the given time
+	const seq_keyframe_t *k = tr->keyframes;
+	int low = tr->track_starts[track], high = tr->track_starts[track + 1];
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (k[mid].t0 <= time) low = mid + 1; else high = mid;
+	}
+	return low;
+}
+
+int seq_bucket_at(const sequencer_queue_t *q, double time) {
+	// Also handles times of -INFINITY and INFINITY
+	if (!(time >= q->bucket_origin)) return 0;
+	const double f = (time - q->bucket_origin) / q->bucket_time;
+	return f >= (double)(q->bucket_count - 1)? q->bucket_count - 1 : (int)f;
+}
+
+bool seq_build_interval_index(sequencer_queue_t *q, const sequence_event *events, arena_t *arena) {
+	// Only events with t0 < t1 are ever active
+	const int n = q->event_count;
+	double first = INFINITY, last = -INFINITY;
+	for (int i = 0; i < n; i++) {
+		const sequence_event *e = &events[i];
+		if (!(e->t0 < e->t1)) continue;
+		first = fmin(first, e->t0);
+		last = fmax(last, isfinite(e->t1)? e->t1 : e->t0);
+	}
+	const double span = first < last? last - first : 0.0;
+	q->bucket_origin = isfinite(first)? first : 0.0;
+	q->bucket_time = fmax(SEQ_MIN_BUCKET_TIME, span / (SEQ_MAX_BUCKETS - 1));
+	q->bucket_count = (int)(span / q->bucket_time) + 1;
+	
+	// Count the events in each bucket, then fill the buckets in table order
+	q->bucket_starts = arena_alloc(arena, sizeof(int) * (size_t)(q->bucket_count + 1));
+	if (!q->bucket_starts) return false;
+	memset(q->bucket_starts, 0, sizeof(int) * (size_t)(q->bucket_count + 1));
+	for (int i = 0; i < n; i++) {
+		const sequence_event *e = &events[i];
+		if (!(e->t0 < e->t1)) continue;
+		for (int b = seq_bucket_at(q, e->t0), b1 = seq_bucket_at(q, e->t1); b <= b1; b++) {
+			q->bucket_starts[b + 1]++;
+		}
+	}
+	for (int b = 0; b < q->bucket_count; b++) {
+		q->bucket_starts[b + 1] += q->bucket_starts[b];
+	}
+	q->bucket_events = arena_alloc(arena, sizeof(int) * (size_t)(q->bucket_starts[q->bucket_count] + 1));
+	if (!q->bucket_events) return false;
+	arena_mark_t mark = arena_mark(&frame_arena);
+	int *fill = arena_alloc(&frame_arena, sizeof(int) * (size_t)q->bucket_count);
+	if (!fill) return false;
+	memcpy(fill, q->bucket_starts, sizeof(int) * (size_t)q->bucket_count);
+	for (int i = 0; i < n; i++) {
+		const sequence_event *e = &events[i];
+		if (!(e->t0 < e->t1)) continue;
+		for (int b = seq_bucket_at(q, e->t0), b1 = seq_bucket_at(q, e->t1); b <= b1; b++) {
+			q->bucket_events[fill[b]++] = i;
+		}
+	}
+	arena_restore(&frame_arena, mark);
+	return true;
+}
+
+void sequencer_reposition(sequencer_t *seq, double time) {
+	// Move the cursors to the given time, starting events at or before it
+	// and ending events at or before it
+	sequencer_queue_t *q = &seq->queue;
+	const sequence_event *events = seq->events;
+	int low = 0, high = q->event_count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (events[q->start_order[mid]].t0 <= time) low = mid + 1; else high = mid;
+	}
+	q->start_cursor = low;
+	
+	low = 0;
+	high = q->event_count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (events[q->end_order[mid]].t1 <= time) low = mid + 1; else high = mid;
+	}
+	q->end_cursor = low;
+	
+	// Events that have started but not ended, from the bucket that holds the time
+	q->active_count = 0;
+	if (q->event_count > 0) {
+		const int b = seq_bucket_at(q, time);
+		for (int k = q->bucket_starts[b]; k < q->bucket_starts[b + 1]; k++) {
+			const int i = q->bucket_events[k];
+			if (events[i].t0 <= time && time < events[i].t1) {
+				q->active[q->active_count++] = i;
+			}
+		}
+	}
+	for (int i = 0; i < seq->tracks.track_count; i++) {
+		seq->tracks.cursors[i] = seq_track_search(&seq->tracks, i, time);
+	}
+	q->time = time;
+}
+
+int seq_track_index(const sequencer_tracks_t *tr, event_commands cmd, uint32_t target, seq_property property) {
+	// Meshes come first, then shapes
+	bool is_mesh = (cmd == ShowMesh || cmd == MoveMesh || cmd == RotateMesh || cmd == ScaleMesh || cmd == SetMeshOpacity);
+	int object = is_mesh? (int)target : tr->mesh_count + (int)target;
+	return object * PropertyCount + property;
+}
+
+int seq_event_keyframes(const sequencer_t *seq, int index, int tracks[4], seq_keyframe_t keyframes[4]) {
+	// Returns the number of keyframes the event adds, and the tracks they belong to
+	const sequence_event *event = &seq->events[index];
+	const sequencer_tracks_t *tr = &seq->tracks;
+	const int cmd = event->cmd;
+	const vec3_t shown = vec3_make(1, 1, 1);
+	const vec3_t hidden = vec3_make(0, 0, 0);
+	const seq_keyframe_t start = { .t0 = event->t0, .t1 = event->t0, .event = index, .phase = PhaseStart };
+	const seq_keyframe_t update = { .t0 = event->t0, .t1 = event->t1, .from = event->p0, .to = event->p1, .ease = event->ease, .event = index, .phase = PhaseUpdate };
+	const seq_keyframe_t end = { .t0 = event->t1, .t1 = event->t1, .event = index, .phase = PhaseEnd };
+	
+	switch (cmd) {
+		case ShowMesh:
+		case ShowShape:
+			// Shown until the end, and moved and rotated at the start
+			tracks[0] = seq_track_index(tr, cmd, event->target, PropertyVisible);
+			tracks[1] = tracks[0];
+			tracks[2] = seq_track_index(tr, cmd, event->target, PropertyPosition);
+			tracks[3] = seq_track_index(tr, cmd, event->target, PropertyRotation);
+			keyframes[0] = start;
+			keyframes[0].from = keyframes[0].to = shown;
+			keyframes[1] = end;
+			keyframes[1].from = keyframes[1].to = hidden;
+			keyframes[2] = start;
+			keyframes[2].from = keyframes[2].to = event->p0;
+			keyframes[3] = start;
+			keyframes[3].from = keyframes[3].to = event->p1;
+			return 4;
+		case MoveMesh:
+		case MoveShape:
+			tracks[0] = seq_track_index(tr, cmd, event->target, PropertyPosition);
+			break;
+		case RotateMesh:
+		case RotateShape:
+			tracks[0] = seq_track_index(tr, cmd, event->target, PropertyRotation);
+			break;
+		case ScaleMesh:
+		case ScaleShape:
+			tracks[0] = seq_track_index(tr, cmd, event->target, PropertyScale);
+			break;
+		case SetMeshOpacity:
+		case SetShapeOpacity:
+			tracks[0] = seq_track_index(tr, cmd, event->target, PropertyOpacity);
+			break;
+		default:
+			return 0;
+	}
+	keyframes[0] = update;
+	return 1;
+}
+
+int seq_compare_keyframes(const void *a, const void *b) {
+	const seq_keyframe_t *x = a;
+	const seq_keyframe_t *y = b;
+	if (x->t0 != y->t0) return x->t0 < y->t0? -1 : 1;
+	if (x->phase != y->phase) return x->phase < y->phase? -1 : 1;
+	return x->event - y->event;
+}
+
+void seq_warn_overlap(const sequencer_tracks_t *tr, int track, double time) {
+	const char *const property_names[] = { "visibility", "position", "rotation", "scale", "opacity" };
+	const int object = track / PropertyCount;
+	const int shape = object - tr->mesh_count;
+	const char *name = "object";
+	if (object < tr->mesh_count) {
+		if (object < SEQ_ARRAY_COUNT(seq_mesh_names)) name = seq_mesh_names[object];
+	} else {
+		if (shape < SEQ_ARRAY_COUNT(seq_shape_names)) name = seq_shape_names[shape];
+	}
+	fprintf(stderr, "Timeline animates %s %s with overlapping events at %.3fs; the later event in the file wins.\n", name, property_names[track % PropertyCount], time);
+}
+
+bool sequencer_compile_tracks(sequencer_t *seq, gameplay_t *scene, int event_count) {
+	sequencer_tracks_t *tr = &seq->tracks;
+	arena_t *arena = &seq->arena;
+	tr->mesh_count = scene->meshes.length;
+	tr->shape_count = scene->shapes.length;
+	tr->track_count = (tr->mesh_count + tr->shape_count) * PropertyCount;
+	
+	int tracks[4];
+	seq_keyframe_t keyframes[4];
+	tr->track_starts = arena_alloc(arena, sizeof(int) * (tr->track_count + 1));
+	if (!tr->track_starts) {
+		fprintf(stderr, "Unable to allocate sequencer tracks!\n");
+		tr->track_count = 0;
+		return false;
+	}
+	
+	// Count keyframes per track
+	memset(tr->track_starts, 0, sizeof(int) * (tr->track_count + 1));
+	int keyframe_count = 0;
+	for (int i = 0; i < event_count; i++) {
+		int n = seq_event_keyframes(seq, i, tracks, keyframes);
+		for (int k = 0; k < n; k++) {
+			tr->track_starts[tracks[k]]++;
+		}
+		keyframe_count += n;
+	}
+	
+	tr->keyframes = arena_alloc(arena, sizeof(seq_keyframe_t) * (keyframe_count + 1));
+	if (!tr->keyframes) {
+		fprintf(stderr, "Unable to allocate sequencer tracks!\n");
+		tr->track_count = 0;
+		return false;
+	}
+	
+	// Fill in each track from its end, leaving track_starts at each track's first keyframe
+	int total = 0;
+	for (int i = 0; i <= tr->track_count; i++) {
+		total += tr->track_starts[i];
+		tr->track_starts[i] = total;
+	}
+	for (int i = 0; i < event_count; i++) {
+		int n = seq_event_keyframes(seq, i, tracks, keyframes);
+		for (int k = 0; k < n; k++) {
+			tr->keyframes[--tr->track_starts[tracks[k]]] = keyframes[k];
+		}
+	}
+	
+	for (int i = 0; i < tr->track_count; i++) {
+		seq_keyframe_t *k = &tr->keyframes[tr->track_starts[i]];
+		int n = tr->track_starts[i + 1] - tr->track_starts[i];
+		qsort(k, n, sizeof(seq_keyframe_t), seq_compare_keyframes);
+		double latest = -INFINITY;
+		double busy_until = -INFINITY;
+		for (int j = 0; j < n; j++) {
+			latest = fmax(latest, k[j].t1);
+			k[j].latest_t1 = latest;
+			
+			// Events animating the same property at once are allowed, but only one of them shows
+			if (k[j].phase == PhaseUpdate) {
+				if (hot_reload_enabled && k[j].t0 < busy_until) {
+					seq_warn_overlap(tr, i, k[j].t0);
+				}
+				busy_until = fmax(busy_until, k[j].t1);
+			}
+		}
+	}
+	
+	// Playback state: cursors, and the tracks to evaluate in one update
+	int *state = arena_alloc(arena, sizeof(int) * (tr->track_count * 2 + 1));
+	tr->is_dirty = arena_alloc(arena, sizeof(bool) * (tr->track_count + 1));
+	tr->found = arena_alloc(arena, sizeof(seq_keyframe_t *) * (tr->track_count + 1));
+	tr->eases = arena_alloc(arena, sizeof(easing_curve) * (tr->track_count + 1));
+	tr->progress = arena_alloc(arena, sizeof(float) * (tr->track_count + 1));
+	if (!state || !tr->is_dirty || !tr->found || !tr->eases || !tr->progress) {
+		fprintf(stderr, "Unable to allocate sequencer tracks!\n");
+		tr->track_count = 0;
+		return false;
+	}
+	tr->cursors = state;
+	tr->dirty = state + tr->track_count;
+	tr->dirty_count = 0;
+	memset(tr->is_dirty, 0, sizeof(bool) * tr->track_count);
+	return true;
+}
+
+void sequencer_save_initial_states(sequencer_t *seq, gameplay_t *scene) {
+	// Objects are put back to how they were created when seeking before their first event
+	const int mesh_count = scene->meshes.length;
+	const int shape_count = scene->shapes.length;
+	seq_initial_state_t *states = arena_alloc(&scene->arena, sizeof(seq_initial_state_t) * (mesh_count + shape_count + 1));
+	seq->initial_states = states;
+	if (!states) {
+		fprintf(stderr, "Unable to allocate sequencer initial states!\n");
+		return;
+	}
+	for (int i = 0; i < mesh_count; i++) {
+		mesh_t *mesh = scene->meshes.array[i];
+		states[i] = (seq_initial_state_t){ mesh_get_position(mesh), mesh_get_rotation(mesh), mesh->scale };
+	}
+	for (int i = 0; i < shape_count; i++) {
+		shape_t *shape = scene->shapes.array[i];
+		seq_initial_state_t *state = &states[mesh_count + i];
+		const vec2_t position = shape_get_position(shape);
+		state->position = vec3_make(position.x, position.y, 0);
+		state->rotation = vec3_make(shape_get_rotation(shape), 0, 0);
+		state->scale = vec3_make(shape->scale.x, shape->scale.y, 1);
+	}
+}
+
+bool sequencer_compile_events(sequencer_t *seq, gameplay_t *scene) {
+	sequencer_queue_t *q = &seq->queue;
+	arena_t *arena = &seq->arena;
+	int n = 0;
+	while (seq->events[n].cmd != EndSequence) {
+		n++;
+	}
+	if (!easing_set_curves(seq->curves, seq->curve_count)) {
+		q->event_count = 0;
+		return false;
+	}
+	
+	int *indexes = arena_alloc(arena, sizeof(int) * (n * 4 + 1));
+	if (!indexes) {
+		fprintf(stderr, "Unable to allocate sequencer queues!\n");
+		q->event_count = 0;
+		return false;
+	}
+	q->event_count = n;
+	q->start_order = indexes;
+	q->end_order = indexes + n;
+	q->active = indexes + n * 2;
+	q->changed = indexes + n * 3;
+	if (!seq_sort_events(q->start_order, seq->events, n, false) ||
+		!seq_sort_events(q->end_order, seq->events, n, true) ||
+		!seq_build_interval_index(q, seq->events, arena)) {
+		fprintf(stderr, "Unable to allocate sequencer queues!\n");
+		q->event_count = 0;
+		return false;
+	}
+	if (!sequencer_compile_tracks(seq, scene, n)) {
+		q->event_count = 0;
+		return false;
+	}
+	seq->beat_map = (beat_map_t){ NULL, 0, seq->beats_per_bar, NULL, 0, 0.0 };
+	if (seq->segment_count > 0 && !beat_map_init(&seq->beat_map, seq->segments, seq->segment_count, seq->beats_per_bar, arena)) {
+		q->event_count = 0;
+		return false;
+	}
+	sequencer_reposition(seq, -INFINITY);
+	return true;
+}
+
+void seq_set_show(sequencer_t *seq, const timeline_t *show) {
+	// A show that failed to load has no events
+	seq->events = show->events? show->events : seq_no_events;
+	seq->curves = show->curves;
+	seq->curve_count = show->curve_count;
+	seq->segments = show->segments;
+	seq->segment_count = show->segment_count;
+	seq->beats_per_bar = show->beats_per_bar;
+}
+
+bool sequencer_load_show(timeline_t *show) {
+	return timeline_load(show, SEQUENCER_TIMELINE_PATH, &seq_targets);
 }
 
-void sequencer_init(gameplay_t *scene) {
+void sequencer_init(gameplay_t *scene, const timeline_t *show) {
+	sequencer_t *seq = arena_alloc(&scene->arena, sizeof(sequencer_t));
+	scene->sequencer = seq;
+	if (!seq) {
+		fprintf(stderr, "Unable to allocate sequencer!\n");
+		return;
+	}
+	*seq = (sequencer_t){ .arena = { NULL, 16 * 1024 } };
+	
 	// Create all the objects used by sequence
 	
 	// -- Meshes --
@@ -452,19 +743,19 @@ void sequencer_init(gameplay_t *scene) {
 	// Grid_Mesh
 	m = mesh_create_grid(16);
 	m->line_color = rgb_to_abgr(COLOR_RGB_RED_2);
-	array_list_add(scene->meshes, m);
+	mesh_list_add(&scene->meshes, m);
 	
 	// Mtn_#_Mesh
 	for (int i=0; i<5; i++) {
 		m = mesh_create_pyramid();
 		m->line_color = rgb_to_abgr(COLOR_RGB_RED_3);
-		array_list_add(scene->meshes, m);
+		mesh_list_add(&scene->meshes, m);
 	}
 	
 	// Radio_Tower_Mesh
 	m = mesh_create_pyramid();
 	m->line_color = rgb_to_abgr(COLOR_RGB_GREEN_1);
-	array_list_add(scene->meshes, m);
+	mesh_list_add(&scene->meshes, m);
 
 	// Fireworks_#_Mesh
 	for (int i=0; i<2; i++) {
@@ -472,41 +763,52 @@ void sequencer_init(gameplay_t *scene) {
 		m->use_backface_culling = false;
 		m->point_color = rgba_to_abgr(COLOR_RGB_GREEN_2, 127);
 		m->line_color = 0;
-		mesh_set_angular_momentum_degrees(m, vec3_make(0.1f, 0.5f, 0));
-		array_list_add(scene->meshes, m);
+		mesh_set_angular_momentum_degrees(m, vec3_make(6, 30, 0));
+		mesh_list_add(&scene->meshes, m);
 	}
 	
 	// UFO_Mesh
-	array_list_add(scene->meshes, mesh_create_ufo());
+	mesh_list_add(&scene->meshes, mesh_create_ufo());
+	
+	// Particle emitters
+	for (int i = 0; i < SEQ_EMITTER_COUNT; i++) {
+		seq->emitters[i] = seq_emitters[i];
+		seq->emitters[i].color = rgb_to_abgr(seq_emitters[i].color);
+	}
+	
+	// Color tracks
+	seq_color_track_init(&seq->bg_color_track, seq->bg_color_keyframes, seq_bg_colors, SEQ_ARRAY_COUNT(seq_bg_colors), 255, 0.0);
+	seq_color_track_init(&seq->ufo_line_track, seq->ufo_line_keyframes, seq_ufo_line_colors, SEQ_ARRAY_COUNT(seq_ufo_line_colors), 255, 6.0);
+	seq_color_track_init(&seq->ufo_point_track, seq->ufo_point_keyframes, seq_ufo_point_colors, SEQ_ARRAY_COUNT(seq_ufo_point_colors), 127, 6.0);
 
 	// Ball_Mesh
 	m = mesh_create_sphere(3);
 	m->line_color = rgb_to_abgr(COLOR_RGB_WHITE);
-	mesh_set_angular_momentum_degrees(m, vec3_make(0, -0.25, 0));
-	array_list_add(scene->meshes, m);
+	mesh_set_angular_momentum_degrees(m, vec3_make(0, -15, 0));
+	mesh_list_add(&scene->meshes, m);
 	
 	// Cone_1_Mesh: nested inside another mesh for rotations
-	m = mesh_new(0);
+	m = mesh_new(0, 0);
 	if (m) {
-		mesh_set_angular_momentum_degrees(m, vec3_make(0, 0.5f, 0));
+		mesh_set_angular_momentum_degrees(m, vec3_make(0, 30, 0));
 		mesh_t *cone = mesh_create_traffic_cone();
 		if (cone) {
 			mesh_set_rotation_degrees(cone, vec3_make(15, 15, 0));
 			mesh_add_child(m, cone);
 		}
-		array_list_add(scene->meshes, m);
+		mesh_list_add(&scene->meshes, m);
 	}
 	
 	// Cone_2_Mesh
-	m = mesh_new(0);
+	m = mesh_new(0, 0);
 	if (m) {
-		mesh_set_angular_momentum_degrees(m, vec3_make(0, -0.75f, 0));
+		mesh_set_angular_momentum_degrees(m, vec3_make(0, -45, 0));
 		mesh_t *cone = mesh_create_traffic_cone();
 		if (cone) {
 			mesh_set_rotation_degrees(cone, vec3_make(5, -30, 0));
 			mesh_add_child(m, cone);
 		}
-		array_list_add(scene->meshes, m);
+		mesh_list_add(&scene->meshes, m);
 	}
 
 	// -- Shapes --
@@ -521,60 +823,92 @@ void sequencer_init(gameplay_t *scene) {
 	desktop->fill_color = rgb_to_abgr(COLOR_RGB_SKIN_2);
 	desktop->position = vec2_make(0, -0.62f);
 	shape_add_child(window, desktop);
-	array_list_add(scene->shapes, window);
+	shape_list_add(&scene->shapes, window);
 
 	// Moon_Shape,
 	s = create_crescent_moon_shape();
 	s->line_color = rgb_to_abgr(COLOR_RGB_OUTLINE);
 	s->fill_color = rgba_to_abgr(COLOR_RGB_YELLOW_1, 228);
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
 
 	// Heart_Shape,
 	s = create_heart_shape();
 	s->line_color = rgb_to_abgr(COLOR_RGB_OUTLINE);
 	s->fill_color = rgba_to_abgr(COLOR_RGB_RED_1, 127);
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
 
 	// Star_Shape,
 	s = create_star_shape(5, 1, 0.5f);
 	s->line_color = rgb_to_abgr(COLOR_RGB_GREEN_3);
 	s->fill_color = rgba_to_abgr(COLOR_RGB_GREEN_1, 127);
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
 
 	// Envelope_Shape,
 	s = create_envelope_shape(COLOR_RGB_OUTLINE);
 	s->fill_color = rgba_to_abgr(COLOR_RGB_WHITE_3, 255);
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
 
 	// Monitor_Shape,
-	array_list_add(scene->shapes, create_monitor_shape());
+	shape_list_add(&scene->shapes, create_monitor_shape());
 
 	// Smoke_1_Shape, Smoke_2_Shape, Smoke_3_Shape,
-	array_list_add(scene->shapes, create_smoke_circle_shape());
-	array_list_add(scene->shapes, create_smoke_circle_shape());
-	array_list_add(scene->shapes, create_smoke_circle_shape());
+	shape_list_add(&scene->shapes, create_smoke_circle_shape());
+	shape_list_add(&scene->shapes, create_smoke_circle_shape());
+	shape_list_add(&scene->shapes, create_smoke_circle_shape());
 
 	// CPU_Shape,
-	array_list_add(scene->shapes, create_cpu_shape());
+	shape_list_add(&scene->shapes, create_cpu_shape());
 
 	// Microphone_Shape,
-	array_list_add(scene->shapes, create_microphone_with_stand_shape());
+	shape_list_add(&scene->shapes, create_microphone_with_stand_shape());
 
 	// Smoke_4_Shape
-	array_list_add(scene->shapes, create_smoke_circle_shape());
+	shape_list_add(&scene->shapes, create_smoke_circle_shape());
 
 	// Bolt_1_Shape, Bolt_2_Shape
-	array_list_add(scene->shapes, create_lighting_bolt_shape());
+	shape_list_add(&scene->shapes, create_lighting_bolt_shape());
 	s = create_lighting_bolt_shape();
 	s->line_color = rgb_to_abgr(COLOR_RGB_OUTLINE);
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
 
 	// Explosion_Shape,
 	s = create_polygon_shape(32, 1.0);
 	s->line_color = 0;
 	s->fill_color = COLOR_ABGR_WHITE;
-	array_list_add(scene->shapes, s);
+	shape_list_add(&scene->shapes, s);
+
+	// -- Events --
+	sequencer_save_initial_states(seq, scene);
+	seq_set_show(seq, show);
+	sequencer_compile_events(seq, scene);
+}
+
+bool sequencer_reload(gameplay_t *scene, const timeline_t *show) {
+	sequencer_t *seq = scene->sequencer;
+	if (!seq) return false;
+	
+	// Compile the new show, and keep the current one if that fails
+	sequencer_t old = *seq;
+	seq_set_show(seq, show);
+	seq->arena = (arena_t){ NULL, old.arena.block_size };
+	if (!sequencer_compile_events(seq, scene)) {
+		arena_free(&seq->arena);
+		*seq = old;
+		easing_set_curves(seq->curves, seq->curve_count);
+		return false;
+	}
+	
+	arena_free(&old.arena);
+	return true;
+}
 
+void sequencer_free(gameplay_t *scene) {
+	// The compiled show lives in the sequencer's own arena, and the timeline belongs
+	// to whoever loaded it. The sequencer and the objects it animates belong to the
+	// scene's arena.
+	if (!scene->sequencer) return;
+	arena_free(&scene->sequencer->arena);
+	scene->sequencer = NULL;
 }
 
 void sequencer_start(gameplay_t *scene) {
@@ -582,245 +916,251 @@ void sequencer_start(gameplay_t *scene) {
 	scene->bg_color = COLOR_ABGR_BLACK;
 
 	// Hide all objects in scene; reset opacity
-	shape_t **s = (shape_t **)scene->shapes->array;
-	int sn = scene->shapes->length;
+	shape_t **s = scene->shapes.array;
+	int sn = scene->shapes.length;
 	for (int i=0; i<sn; i++) {
 		s[i]->is_visible = false;
 		s[i]->opacity = 1.0f;
 	}
-	mesh_t **m = (mesh_t **)scene->meshes->array;
-	int mn = scene->meshes->length;
+	mesh_t **m = scene->meshes.array;
+	int mn = scene->meshes.length;
 	for (int i=0; i<mn; i++) {
 		m[i]->is_visible = false;
 		m[i]->opacity = 1.0f;
 	}
-
+	particles_remove_all(&scene->particles);
 }
 
-void sequencer_update_bgcolor(gameplay_t *scene, double current_time) {
-	if (current_time <= 0.0) {
-		scene->bg_color = rgb_to_abgr(bg_color_timeline[0].rgb);
-	} else {
-		int i = 1;
-		while (bg_color_timeline[i].t < current_time) {
-			i++;
+void seq_sort_indexes(int *indexes, int n) {
+	// Insertion sort, since only a few events start or end at once
+	for (int i = 1; i < n; i++) {
+		int x = indexes[i];
+		int j = i;
+		while (j > 0 && indexes[j - 1] > x) {
+			indexes[j] = indexes[j - 1];
+			j--;
 		}
-		double t0 = bg_color_timeline[i - 1].t;
-		double t1 = bg_color_timeline[i].t;
-		double x = round((current_time - t0) / (t1 - t0) * 255);
-		uint32_t c0 = rgb_to_abgr(bg_color_timeline[i - 1].rgb);
-		uint32_t c1 = rgba_to_abgr(bg_color_timeline[i].rgb, (uint8_t)x);
-		scene->bg_color = blend_color(c0, c1);
+		indexes[j] = x;
 	}
 }
 
-float apply_easing_curve(easing_curve ease, float x) {
-	// https://easings.net/
-	const float c4 = 2 * (float)M_PI / 3;
-	const float v = 6.0f;
-	const float n1 = 7.5625f;
-	const float d1 = 2.75f;
+void seq_active_insert(sequencer_queue_t *q, int index) {
+	int j = q->active_count;
+	while (j > 0 && q->active[j - 1] > index) {
+		q->active[j] = q->active[j - 1];
+		j--;
+	}
+	q->active[j] = index;
+	q->active_count++;
+}
 
-	switch (ease) {
-		case EaseInQuad:
-			x = x * x;
-			break;
-		case EaseOutQuad:
-			x = (1.0f - x);
-			x = 1.0f - x * x;
-			break;
-		case EaseInCubic:
-			x = x * x * x;
-			break;
-		case EaseOutCubic:
-			x = (1.0f - x);
-			x = 1.0f - x * x * x;
-			break;
-		case EaseOutElastic:
-			if (x <= 0.0f) {
-				x = 0.0f;
-			} else if (x >= 1.0f) {
-				x = 1.0f;
-			} else {
-				x = powf(2, -v * x) * sinf((x * v - 0.75f) * c4) + 1;
-			}
-			break;
-		case EaseOutBounce:
-			if (x < 1.0f / d1) {
-				x = n1 * x * x;
-			} else if (x < 2.0f / d1) {
-				x -= 1.5f / d1;
-				x = n1 * x * x + 0.75f;
-			} else if (x < 2.5f / d1) {
-				x -= 2.25f / d1;
-				x = n1 * x * x + 0.9375f;
-			} else {
-				x -= 2.625f / d1;
-				x = n1 * x * x + 0.984375f;
-			}
-			break;
-		case EaseBezier:
-			x = x * x * (3.0f - 2.0f * x);
-			break;
-		default:
-			// Do nothing
-			break;
+void seq_active_remove(sequencer_queue_t *q, int index) {
+	for (int i = 0; i < q->active_count; i++) {
+		if (q->active[i] == index) {
+			q->active_count--;
+			memmove(&q->active[i], &q->active[i + 1], sizeof(int) * (q->active_count - i));
+			return;
+		}
 	}
+}
+
+const seq_keyframe_t *seq_track_latest(const sequencer_tracks_t *tr, int track, int end, double time) {
+	// Find the keyframe that last wrote to the track at or before the given time,
+	// given the index of the first keyframe after it
+	const seq_keyframe_t *k = tr->keyframes;
+	const int start = tr->track_starts[track];
+	if (end == start) return NULL;
 	
-	return x;
+	// An earlier event that was still writing later than the last one to start takes precedence.
+	// latest_t1 stops the search as soon as no earlier keyframe could.
+	const seq_keyframe_t *found = &k[end - 1];
+	double found_time = fmin(found->t1, time);
+	for (int i = end - 2; i >= start && k[i].latest_t1 >= found_time; i--) {
+		double t = fmin(k[i].t1, time);
+		if (t > found_time || (t == found_time && (k[i].phase > found->phase || (k[i].phase == found->phase && k[i].event > found->event)))) {
+			found = &k[i];
+			found_time = t;
+		}
+	}
+	return found;
 }
 
-float interpolate_float(float a, float b, float x) {
-	return a * (1 - x) + b * x;
+const seq_keyframe_t *seq_track_find(const sequencer_tracks_t *tr, int track, double time) {
+	return seq_track_latest(tr, track, seq_track_search(tr, track, time), time);
 }
 
-void seq_event_start(gameplay_t *scene, sequence_event *event, double time) {
-	mesh_t *mesh;
-	shape_t *shape;
-	
-	switch (event->cmd) {
-		case ShowMesh:  // show mesh and set its position and rotation
-			mesh = scene->meshes->array[event->target];
-			mesh->is_visible = true;
-			mesh->position = vec3_mul(event->p0, POSITION_FACTOR);
-			mesh->rotation = vec3_mul(event->p1, ROTATION_FACTOR);
-			break;
-		case ShowShape:  // show shape and set its position and rotation
-			shape = scene->shapes->array[event->target];
-			shape->is_visible = true;
-			shape->position = vec2_mul(vec3_to_vec2(event->p0), POSITION_FACTOR);
-			shape->rotation = event->p1.x * ROTATION_FACTOR;
-			break;
-		case MoveShape:
-		case MoveMesh:
-		case RotateShape:
-		case RotateMesh:
-		case ScaleShape:
-		case ScaleMesh:
-		case SetShapeOpacity:
-		case SetMeshOpacity:
-			// Do nothing
-			break;
-		default:
-			fprintf(stderr, "Unknown event command, start!\n");
-			break;
+const seq_keyframe_t *seq_track_advance(sequencer_tracks_t *tr, int track, double time) {
+	// Same as seq_track_find() for times that only move forward
+	const seq_keyframe_t *k = tr->keyframes;
+	const int end = tr->track_starts[track + 1];
+	int cursor = tr->cursors[track];
+	while (cursor < end && k[cursor].t0 <= time) {
+		cursor++;
 	}
+	tr->cursors[track] = cursor;
+	return seq_track_latest(tr, track, cursor, time);
 }
 
-void seq_event_update(gameplay_t *scene, sequence_event *event, double time) {
-	mesh_t *mesh;
-	shape_t *shape;
-	float x = (float)((time - event->t0) / (event->t1 - event->t0));
-	x = x <= 1.0? x : 1.0; // Limit to x <= 1.0
-	if (event->ease != EaseLinear) {
-		x = apply_easing_curve(event->ease, x);
+float seq_keyframe_progress(const seq_keyframe_t *k, double time) {
+	// Position within the keyframe before easing, 1 once it has finished
+	if (k->phase != PhaseUpdate) return 1.0f;
+	float x = (float)((time - k->t0) / (k->t1 - k->t0));
+	return x <= 1.0? x : 1.0; // Limit to x <= 1.0
+}
+
+void seq_apply_track(gameplay_t *scene, int track, const seq_keyframe_t *k, float eased_progress) {
+	// Set the property from the keyframe that wrote it last, or to its initial value if none has
+	const sequencer_t *seq = scene->sequencer;
+	const int object = track / PropertyCount;
+	const seq_initial_state_t *initial = &seq->initial_states[object];
+	const vec3_t v = k? vec3_interpolate(k->from, k->to, eased_progress) : vec3_make(0, 0, 0);
+	const bool is_visible = k && k->phase == PhaseStart;
+	
+	if (object < seq->tracks.mesh_count) {
+		mesh_t *mesh = scene->meshes.array[object];
+		switch (track % PropertyCount) {
+			case PropertyVisible:
+				mesh->is_visible = is_visible;
+				break;
+			case PropertyPosition:
+				mesh_set_position(mesh, k? vec3_mul(v, POSITION_FACTOR) : initial->position);
+				break;
+			case PropertyRotation:
+				mesh_set_rotation(mesh, k? vec3_mul(v, ROTATION_FACTOR) : initial->rotation);
+				break;
+			case PropertyScale:
+				mesh_set_scale(mesh, k? vec3_mul(v, SCALE_FACTOR) : initial->scale);
+				break;
+			case PropertyOpacity:
+				mesh->opacity = k? v.x : 1.0f;
+				break;
+		}
+	} else {
+		shape_t *shape = scene->shapes.array[object - seq->tracks.mesh_count];
+		switch (track % PropertyCount) {
+			case PropertyVisible:
+				shape->is_visible = is_visible;
+				break;
+			case PropertyPosition:
+				shape_set_position(shape, vec3_to_vec2(k? vec3_mul(v, POSITION_FACTOR) : initial->position));
+				break;
+			case PropertyRotation:
+				shape_set_rotation(shape, k? v.x * ROTATION_FACTOR : initial->rotation.x);
+				break;
+			case PropertyScale:
+				shape_set_scale(shape, vec3_to_vec2(k? vec3_mul(v, SCALE_FACTOR) : initial->scale));
+				break;
+			case PropertyOpacity:
+				shape->opacity = k? v.x : 1.0f;
+				break;
+		}
+	}
+}
+
+void seq_seek_object(gameplay_t *scene, int object, double time) {
+	const sequencer_tracks_t *tr = &scene->sequencer->tracks;
+	const int track = object * PropertyCount;
+	for (int i = 0; i < PropertyCount; i++) {
+		const seq_keyframe_t *k = seq_track_find(tr, track + i, time);
+		seq_apply_track(scene, track + i, k, k? easing_apply(k->ease, seq_keyframe_progress(k, time)) : 0.0f);
 	}
 	
-	switch (event->cmd) {
-		case MoveShape:
-			shape = scene->shapes->array[event->target];
-			shape->position = vec2_mul(vec3_to_vec2(vec3_interpolate(event->p0, event->p1, x)), POSITION_FACTOR);
-			break;
-		case MoveMesh:
-			mesh = scene->meshes->array[event->target];
-			mesh->position = vec3_mul(vec3_interpolate(event->p0, event->p1, x), POSITION_FACTOR);
-			break;
-		case RotateShape:
-			shape = scene->shapes->array[event->target];
-			shape->rotation = interpolate_float(event->p0.x, event->p1.x, x) * ROTATION_FACTOR;
-			break;
-		case RotateMesh:
-			mesh = scene->meshes->array[event->target];
-			mesh->rotation = vec3_mul(vec3_interpolate(event->p0, event->p1, x), ROTATION_FACTOR);
-			break;
-		case ScaleShape:
-			shape = scene->shapes->array[event->target];
-			shape->scale = vec2_mul(vec3_to_vec2(vec3_interpolate(event->p0, event->p1, x)), SCALE_FACTOR);
-			break;
-		case ScaleMesh:
-			mesh = scene->meshes->array[event->target];
-			mesh->scale = vec3_mul(vec3_interpolate(event->p0, event->p1, x), SCALE_FACTOR);
-			break;
-		case SetShapeOpacity:
-			shape = scene->shapes->array[event->target];
-			shape->opacity = interpolate_float(event->p0.x, event->p1.x, x);
-			break;
-		case SetMeshOpacity:
-			mesh = scene->meshes->array[event->target];
-			mesh->opacity = interpolate_float(event->p0.x, event->p1.x, x);
-			break;
-		case ShowMesh:
-		case ShowShape:
-			// Do nothing
-			break;
-		default:
-			fprintf(stderr, "Unknown event command, in update!\n");
-			break;
+	// Objects keep spinning after their rotation is set
+	const seq_keyframe_t *rotation = seq_track_find(tr, track + PropertyRotation, time);
+	double spin_time = rotation? time - fmin(rotation->t1, time) : fmax(time, 0.0);
+	if (object < tr->mesh_count) {
+		mesh_t *mesh = scene->meshes.array[object];
+		mesh_set_rotation(mesh, vec3_add(mesh_get_rotation(mesh), vec3_mul(mesh_get_angular_momentum(mesh), (float)spin_time)));
+	} else {
+		shape_t *shape = scene->shapes.array[object - tr->mesh_count];
+		shape_set_rotation(shape, shape_get_rotation(shape) + shape_get_angular_momentum(shape) * (float)spin_time);
 	}
 }
 
-void seq_event_end(gameplay_t *scene, sequence_event *event, double time) {
-	mesh_t *mesh;
-	shape_t *shape;
-	switch (event->cmd) {
-		case ShowMesh: // hide mesh
-			mesh = scene->meshes->array[event->target];
-			mesh->is_visible = false;
-			break;
-		case ShowShape:
-			shape = scene->shapes->array[event->target];
-			shape->is_visible = false;
-			break;
-		case MoveShape:
-		case MoveMesh:
-		case RotateShape:
-		case RotateMesh:
-		case ScaleShape:
-		case ScaleMesh:
-		case SetShapeOpacity:
-		case SetMeshOpacity:
-			// Do nothing
-			break;
-		default:
-			fprintf(stderr, "Unknown event command, at end!\n");
-			break;
+void seq_mark_event_tracks(sequencer_t *seq, int index, double previous_time, double current_time) {
+	// Mark the tracks the event writes to within the time period
+	sequencer_tracks_t *tr = &seq->tracks;
+	int tracks[4];
+	seq_keyframe_t keyframes[4];
+	int n = seq_event_keyframes(seq, index, tracks, keyframes);
+	for (int i = 0; i < n; i++) {
+		if (keyframes[i].t0 <= current_time && previous_time < keyframes[i].t1 && !tr->is_dirty[tracks[i]]) {
+			tr->is_dirty[tracks[i]] = true;
+			tr->dirty[tr->dirty_count++] = tracks[i];
+		}
 	}
 }
 
+void sequencer_seek(gameplay_t *scene, double time) {
+	// Put every object where it would be at this time had the sequence played through,
+	// then continue from there. Particles already in the air are not recreated.
+	sequencer_t *seq = scene->sequencer;
+	if (!seq) return;
+	const int object_count = seq->initial_states? seq->tracks.track_count / PropertyCount : 0;
+	for (int i = 0; i < object_count; i++) {
+		seq_seek_object(scene, i, time);
+	}
+	particles_remove_all(&scene->particles);
+	sequencer_update_colors(scene, time);
+	sequencer_reposition(seq, time);
+}
+
 void sequencer_update(gameplay_t *scene, double previous_time, double current_time) {
-	sequencer_update_bgcolor(scene, current_time);
+	sequencer_t *seq = scene->sequencer;
+	if (!seq) return;
+	sequencer_update_colors(scene, current_time);
+
+	const sequence_event *events = seq->events;
+	sequencer_queue_t *q = &seq->queue;
+	if (previous_time != q->time) {
+		sequencer_reposition(seq, previous_time);
+	}
 	
-	// Color cycling for UFO
-	int hue = (int)round(current_time * 60.0) % 360;
-	uint32_t line_color = color_from_hsv(hue, 1.0, 0.5, 1.0);
-	uint32_t point_color = color_from_hsv((hue + 90) % 360, 1.0, 1.0, 0.5);
-	mesh_t *ufo = scene->meshes->array[UFO_Mesh];
-	mesh_set_children_color(ufo, line_color, point_color);
-
-	// Events starting within time period
-	for (int i = 0; seq_events[i].cmd != EndSequence; i++) {
-		double t0 = seq_events[i].t0;
-		if (previous_time < t0 && t0 <= current_time) {
-			seq_event_start(scene, &seq_events[i], current_time);
-		}
+	// Events starting within time period, in table order
+	int n = 0;
+	while (q->start_cursor < q->event_count && events[q->start_order[q->start_cursor]].t0 <= current_time) {
+		q->changed[n++] = q->start_order[q->start_cursor++];
 	}
-
-	// Events updating within time period
-	for (int i = 0; seq_events[i].cmd != EndSequence; i++) {
-		double t0 = seq_events[i].t0;
-		double t1 = seq_events[i].t1;
-		if (previous_time < t1 && t0 <= current_time) {
-			seq_event_update(scene, &seq_events[i], current_time);
+	seq_sort_indexes(q->changed, n);
+	for (int i = 0; i < n; i++) {
+		const sequence_event *event = &events[q->changed[i]];
+		if (event->cmd == EmitParticles) {
+			particles_emit(&scene->particles, &seq->emitters[event->target], vec3_mul(event->p0, POSITION_FACTOR));
 		}
+		seq_active_insert(q, q->changed[i]);
+	}
+	
+	// Every event starting, in progress or ending within the time period is active here.
+	// Each property they write is then set once, from the curve of its track.
+	sequencer_tracks_t *tr = &seq->tracks;
+	tr->dirty_count = 0;
+	for (int i = 0; i < q->active_count; i++) {
+		seq_mark_event_tracks(seq, q->active[i], previous_time, current_time);
+	}
+	for (int i = 0; i < tr->dirty_count; i++) {
+		const seq_keyframe_t *k = seq_track_advance(tr, tr->dirty[i], current_time);
+		tr->found[i] = k;
+		tr->eases[i] = k->ease;
+		tr->progress[i] = seq_keyframe_progress(k, current_time);
+	}
+	easing_apply_batch(tr->eases, tr->progress, tr->dirty_count);
+	for (int i = 0; i < tr->dirty_count; i++) {
+		seq_apply_track(scene, tr->dirty[i], tr->found[i], tr->progress[i]);
+		tr->is_dirty[tr->dirty[i]] = false;
 	}
 	
 	// Events ending within time period
-	for (int i = 0; seq_events[i].cmd != EndSequence; i++) {
-		double t1 = seq_events[i].t1;
-		if (previous_time < t1 && t1 <= current_time) {
-			seq_event_end(scene, &seq_events[i], current_time);
-		}
+	n = 0;
+	while (q->end_cursor < q->event_count && events[q->end_order[q->end_cursor]].t1 <= current_time) {
+		q->changed[n++] = q->end_order[q->end_cursor++];
 	}
+	for (int i = 0; i < n; i++) {
+		seq_active_remove(q, q->changed[i]);
+	}
+	q->time = current_time;
+}
 
-	
+const beat_map_t *sequencer_beat_map(const gameplay_t *scene) {
+	const sequencer_t *seq = scene->sequencer;
+	return (seq && seq->beat_map.segment_count > 0)? &seq->beat_map : NULL;
 }
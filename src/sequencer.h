@@ -8,11 +8,24 @@
 #ifndef sequencer_h
 #define sequencer_h
 
+#include "beat_map.h"
 #include "scene_gameplay.h"
+#include "timeline.h"
 
-void sequencer_init(gameplay_t *scene);
+// Text timeline of the gameplay show, see timeline.h
+#define SEQUENCER_TIMELINE_PATH "assets/song_90s.timeline"
+
+// Load the show once, on the main thread. The sequencers of every thread only
+// read it, so it must outlive them.
+bool sequencer_load_show(timeline_t *show);
+
+void sequencer_init(gameplay_t *scene, const timeline_t *show);
+void sequencer_free(gameplay_t *scene);
 void sequencer_start(gameplay_t *scene);
 void sequencer_update(gameplay_t *scene, double previous_time, double current_time);
+void sequencer_seek(gameplay_t *scene, double time);
+bool sequencer_reload(gameplay_t *scene, const timeline_t *show); // keeps the current show if the new one fails to compile
+const beat_map_t *sequencer_beat_map(const gameplay_t *scene); // NULL if the timeline has no tempo
 
 
 #endif /* sequencer_h */
@@ -8,37 +8,49 @@
 #include "shape.h"
 #include "color.h"
 #include "drawing.h"
-#include "array_list.h"
+#include "arena.h"
+#include "physics.h"
+#include "pool.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 
+// Shapes allocated outside of a scene arena
+_Thread_local pool_t shape_pool = POOL_INIT(shape_t, 64);
 
-#define projected_points_capacity (256)
-vec2_t projected_points[projected_points_capacity];
+_Thread_local uint32_t shape_tree_version = 0;
+
+// Ratio a shape's screen radius must exceed a threshold by to switch back to more detail
+#define SHAPE_LOD_HYSTERESIS (1.25f)
 
 
 shape_t *shape_new(int initial_capacity) {
-	shape_t *shape = malloc(sizeof(shape_t));
+	// Same ownership rules as mesh_new()
+	arena_t *arena = scene_arena;
+	shape_t *shape = arena? arena_alloc(arena, sizeof(shape_t)) : pool_alloc(&shape_pool);
 	if (!shape) {
 		fprintf(stderr, "Unable to allocate shape!\n");
 		return NULL;
 	}
-	if (initial_capacity > 0) {
-		shape->points = point_list_new(initial_capacity);
-		if (!shape->points) {
-			fprintf(stderr, "Unable to allocate shape points!\n");
-			free(shape);
-			return NULL;
-		}
-	} else {
-		shape->points = NULL;
+	shape->arena = arena;
+	point_list_init(&shape->points, arena);
+	if (!point_list_reserve(&shape->points, initial_capacity)) {
+		fprintf(stderr, "Unable to allocate shape points!\n");
+		if (!arena) pool_free(&shape_pool, shape);
+		return NULL;
 	}
 	
 	shape->is_closed = true;
-	shape->children = NULL;
+	shape_list_init(&shape->children, arena);
+	
+	// Level of detail
+	shape->lower_detail = NULL;
+	shape->lod_min_screen_radius = 0.0f;
+	shape->lod_bounding_radius = 0.0f;
+	shape->lod_level = 0;
 	
 	// Visuals
 	shape->is_visible = true;
@@ -54,127 +66,439 @@ shape_t *shape_new(int initial_capacity) {
 	shape->angular_momentum = 0.0f; // radians/second
 	
 	shape->lifetime = 0.0;
+	
+	// Transforms are calculated on first draw
+	shape->local_transform = affine2_identity();
+	shape->world_transform = affine2_identity();
+	shape->transform_dirty = true;
+	
+	shape->graph = NULL;
+	shape->graph_index = -1;
 	return shape;
 }
 
 void shape_destroy(shape_t *shape) {
-	if (shape->children) {
-		shape_t **a = (shape_t **)shape->children->array;
-		int n = shape->children->length;
-		for (int i=0; i<n; i++) {
-			shape_destroy(a[i]);
-		}
-		array_list_destroy(shape->children);
-	}
+	// Arena shapes are freed along with their arena
+	if (shape->arena) return;
 	
-	if (shape->points) {
-		point_list_destroy(shape->points);
+	for (int i=0; i<shape->children.length; i++) {
+		shape_destroy(shape->children.array[i]);
+	}
+	shape_list_free(&shape->children);
+	if (shape->lower_detail) {
+		shape_destroy(shape->lower_detail);
 	}
-	free(shape);
+	
+	point_list_free(&shape->points);
+	pool_free(&shape_pool, shape);
 }
 
 bool shape_add_point(shape_t *shape, vec2_t point) {
-	if (!shape->points) {
-		shape->points = point_list_new(4);
-		if (!shape->points) {
-			fprintf(stderr, "Unable to allocate shape points!\n");
-			return false;
-		}
+	return point_list_add(&shape->points, point);
+}
+
+bool shape_add_points(shape_t *shape, const vec2_t *points, int n) {
+	return point_list_append(&shape->points, points, n);
+}
+
+bool shape_add_child(shape_t *shape, shape_t *child) {
+	shape_tree_version++;
+	return shape_list_add(&shape->children, child);
+}
+
+void shape_set_lower_detail(shape_t *shape, shape_t *lower_detail, float min_screen_radius) {
+	// The shape takes ownership of the lower detail points, which can have their own lower detail
+	if (shape->lower_detail) shape_destroy(shape->lower_detail);
+	shape->lower_detail = lower_detail;
+	shape->lod_min_screen_radius = min_screen_radius;
+	shape->lod_level = 0;
+	
+	float r = 0.0f;
+	for (int i = 0; i < shape->points.length; i++) {
+		r = fmaxf(r, vec2_length(shape->points.array[i]));
 	}
-	return point_list_add(shape->points, point);
+	shape->lod_bounding_radius = r;
 }
 
-bool shape_add_points(shape_t *shape, point_list_t *points) {
-	for (int i = 0; i < points->length; i++) {
-		if (!shape_add_point(shape, points->array[i])) return false;
+#pragma mark -
+
+void shape_set_position(shape_t *shape, vec2_t position) {
+	if (shape->graph) {
+		shape->graph->positions[shape->graph_index] = position;
+	} else {
+		shape->position = position;
 	}
-	return true;
+	shape->transform_dirty = true;
 }
 
-bool shape_add_child(shape_t *shape, shape_t *child) {
-	if (!shape->children) {
-		shape->children = array_list_new(4);
-		if (!shape->children) return false;
+void shape_set_rotation(shape_t *shape, float rotation) {
+	if (shape->graph) {
+		shape->graph->rotations[shape->graph_index] = rotation;
+	} else {
+		shape->rotation = rotation;
+	}
+	shape->transform_dirty = true;
+}
+
+void shape_set_scale(shape_t *shape, vec2_t scale) {
+	shape->scale = scale;
+	shape->transform_dirty = true;
+}
+
+void shape_set_linear_momentum(shape_t *shape, vec2_t momentum) {
+	if (shape->graph) {
+		shape->graph->linear_momenta[shape->graph_index] = momentum;
+	} else {
+		shape->linear_momentum = momentum;
+	}
+}
+
+void shape_set_angular_momentum(shape_t *shape, float momentum) {
+	if (shape->graph) {
+		shape->graph->angular_momenta[shape->graph_index] = momentum;
+	} else {
+		shape->angular_momentum = momentum;
 	}
-	return array_list_add(shape->children, child);
+}
+
+vec2_t shape_get_position(const shape_t *shape) {
+	return shape->graph? shape->graph->positions[shape->graph_index] : shape->position;
+}
+
+float shape_get_rotation(const shape_t *shape) {
+	return shape->graph? shape->graph->rotations[shape->graph_index] : shape->rotation;
+}
+
+vec2_t shape_get_linear_momentum(const shape_t *shape) {
+	return shape->graph? shape->graph->linear_momenta[shape->graph_index] : shape->linear_momentum;
+}
+
+float shape_get_angular_momentum(const shape_t *shape) {
+	return shape->graph? shape->graph->angular_momenta[shape->graph_index] : shape->angular_momentum;
 }
 
 #pragma mark -
 
 void shape_update(shape_t *shape, double delta_time) {
-	if (shape->children) {
-		shape_t **a = (shape_t **)shape->children->array;
-		int n = shape->children->length;
-		for (int i=0; i<n; i++) {
-			shape_update(a[i], delta_time);
-		}
+	shape_t **a = shape->children.array;
+	int n = shape->children.length;
+	for (int i=0; i<n; i++) {
+		shape_update(a[i], delta_time);
 	}
+	shape_integrate(shape, delta_time);
+}
 
+void shape_integrate(shape_t *shape, double delta_time) {
 	float dt = (float)delta_time;
 	
 	// Linear momentum
-	vec2_t movement = vec2_mul(shape->linear_momentum, dt);
-	shape->position = vec2_add(shape->position, movement);
+	if (!vec2_is_zero(shape->linear_momentum)) {
+		vec2_t movement = vec2_mul(shape->linear_momentum, dt);
+		shape->position = vec2_add(shape->position, movement);
+		shape->transform_dirty = true;
+	}
 	
 	// Angular momentum
-	shape->rotation += shape->angular_momentum * dt;
+	if (shape->angular_momentum != 0.0f) {
+		shape->rotation += shape->angular_momentum * dt;
+		shape->transform_dirty = true;
+	}
 	
 	shape->lifetime += delta_time;
 }
 
 void shape_draw(shape_t *shape) {
-	shape_draw_recursive(shape, mat3_identity(), 1.0f);
+	shape_draw_recursive(shape, NULL, false, 1.0f);
+}
+
+const shape_t *shape_select_lod(shape_t *shape, const affine2_t *transform) {
+	if (!shape->lower_detail) return shape;
+	
+	// Radius on screen in pixels, using the largest scale of the view transform
+	float scale = 0.0f;
+	for (int j = 0; j < 2; j++) {
+		vec2_t column = { transform->m[0][j], transform->m[1][j] };
+		scale = fmaxf(scale, vec2_length(column));
+	}
+	const float radius = shape->lod_bounding_radius * scale;
+	
+	// Same hysteresis as meshes: add detail back only once clearly above the threshold
+	const shape_t *geometry = shape;
+	int level = 0;
+	while (geometry->lower_detail && geometry->lower_detail->points.length > 0) {
+		float threshold = geometry->lod_min_screen_radius;
+		if (level < shape->lod_level) threshold *= SHAPE_LOD_HYSTERESIS;
+		if (radius >= threshold) break;
+		geometry = geometry->lower_detail;
+		level++;
+	}
+	shape->lod_level = level;
+	return geometry;
 }
 
-void shape_draw_recursive(shape_t *shape, mat3_t transform, float opacity) {
-	if (!shape->is_visible) return;
+void shape_draw_points(shape_t *shape, const affine2_t *world_transform, float opacity) {
+	if (shape->points.length < 2) return;
 	
-	// Calculate transform matrix
-	transform = mat3_translate(transform, shape->position);
-	transform = mat3_rotate(transform, shape->rotation);
-	transform = mat3_scale(transform, shape->scale);
+	set_line_color_abgr(color_mul_opacity(shape->line_color, opacity));
+	set_fill_color_abgr(color_mul_opacity(shape->fill_color, opacity));
+	
+	// Apply world and view transforms in one step
+	const affine2_t transform = affine2_multiply(draw_context->view_transform_2d, *world_transform);
+	
+	// Use fewer points when the shape is small on screen
+	const point_list_t *points = &shape_select_lod(shape, &transform)->points;
+	int n = points->length;
+	arena_mark_t mark = arena_mark(&frame_arena);
+	vec2_t *pp = arena_alloc(&frame_arena, sizeof(vec2_t) * (size_t)n);
+	if (!pp) n = 0;
+	for (int i = 0; i < n; i++) {
+		pp[i] = vec2_affine2_multiply(points->array[i], transform);
+	}
+	
+	// Fill
+	if (shape->fill_color != 0 && n >= 3) {
+		fill_polygon(pp, n);
+	}
+	
+	// Stroke
+	if (shape->line_color != 0 && n > 0) {
+		move_to(pp[0]);
+		for (int i = 1; i < n; i++) {
+			line_to(pp[i]);
+		}
+		if (shape->is_closed) {
+			line_to(pp[0]);
+		}
+	}
+	arena_restore(&frame_arena, mark);
+}
+
+void shape_draw_recursive(shape_t *shape, const affine2_t *parent_transform, bool parent_changed, float opacity) {
+	if (!shape->is_visible) {
+		// Recalculate world transform once the shape is shown again
+		if (parent_changed) shape->transform_dirty = true;
+		return;
+	}
+	
+	// Calculate transform matrix only if this shape or an ancestor has changed
+	bool changed = parent_changed || shape->transform_dirty;
+	if (shape->transform_dirty) {
+		shape->local_transform = affine2_make(shape->position, shape->rotation, shape->scale);
+		shape->transform_dirty = false;
+	}
+	if (changed) {
+		if (parent_transform) {
+			shape->world_transform = affine2_multiply(*parent_transform, shape->local_transform);
+		} else {
+			shape->world_transform = shape->local_transform;
+		}
+	}
 	
 	// Calculate opacity
 	opacity = opacity * shape->opacity;
 
-	if (shape->points) {
-		if (shape->points->length >= 2) {
-			set_line_color_abgr(color_mul_opacity(shape->line_color, opacity));
-			set_fill_color_abgr(color_mul_opacity(shape->fill_color, opacity));
-			
-			// Apply transforms
-			int n = shape->points->length < projected_points_capacity? shape->points->length : projected_points_capacity;
-			vec2_t *pp = projected_points;
-			for (int i = 0; i < n; i++) {
-				vec2_t pt = vec2_mat3_multiply(shape->points->array[i], transform);
-				pp[i] = vec2_mat3_multiply(pt, view_transform_2d);
-			}
-			
-			// Fill
-			if (shape->fill_color != 0 && n >= 3) {
-				fill_polygon(pp, n);
-			}
-			
-			// Stroke
-			if (shape->line_color != 0) {
-				move_to(pp[0]);
-				for (int i = 1; i < n; i++) {
-					line_to(pp[i]);
-				}
-				if (shape->is_closed) {
-					line_to(pp[0]);
-				}
-			}
+	shape_draw_points(shape, &shape->world_transform, opacity);
+	
+	// Children
+	shape_t **a = shape->children.array;
+	int n = shape->children.length;
+	for (int i=0; i<n; i++) {
+		shape_draw_recursive(a[i], &shape->world_transform, changed, opacity);
+	}
+}
+
+#pragma mark - Flattened trees
+
+void shape_graph_init(shape_graph_t *graph) {
+	memset(graph, 0, sizeof(shape_graph_t));
+}
+
+void shape_graph_free(shape_graph_t *graph) {
+	shape_graph_release(graph);
+	free(graph->nodes);
+	free(graph->parents);
+	free(graph->subtree_ends);
+	free(graph->positions);
+	free(graph->linear_momenta);
+	free(graph->rotations);
+	free(graph->angular_momenta);
+	free(graph->previous_positions);
+	free(graph->previous_rotations);
+	free(graph->previous_visible);
+	free(graph->local_transforms);
+	free(graph->world_transforms);
+	free(graph->changed);
+	free(graph->opacities);
+	shape_graph_init(graph);
+}
+
+bool shape_graph_resize_array(void **array, size_t element_size, int capacity) {
+	void *p = realloc(*array, element_size * (size_t)capacity);
+	if (!p) return false;
+	*array = p;
+	return true;
+}
+
+bool shape_graph_reserve(shape_graph_t *graph, int capacity) {
+	if (capacity <= graph->capacity) return true;
+	if (capacity < graph->capacity * 2) capacity = graph->capacity * 2;
+	
+	// Arrays that were grown before a failure just stay larger
+	bool ok = shape_graph_resize_array((void **)&graph->nodes, sizeof(shape_t *), capacity) &&
+		shape_graph_resize_array((void **)&graph->parents, sizeof(int), capacity) &&
+		shape_graph_resize_array((void **)&graph->subtree_ends, sizeof(int), capacity) &&
+		shape_graph_resize_array((void **)&graph->positions, sizeof(vec2_t), capacity) &&
+		shape_graph_resize_array((void **)&graph->linear_momenta, sizeof(vec2_t), capacity) &&
+		shape_graph_resize_array((void **)&graph->rotations, sizeof(float), capacity) &&
+		shape_graph_resize_array((void **)&graph->angular_momenta, sizeof(float), capacity) &&
+		shape_graph_resize_array((void **)&graph->previous_positions, sizeof(vec2_t), capacity) &&
+		shape_graph_resize_array((void **)&graph->previous_rotations, sizeof(float), capacity) &&
+		shape_graph_resize_array((void **)&graph->previous_visible, sizeof(bool), capacity) &&
+		shape_graph_resize_array((void **)&graph->local_transforms, sizeof(affine2_t), capacity) &&
+		shape_graph_resize_array((void **)&graph->world_transforms, sizeof(affine2_t), capacity) &&
+		shape_graph_resize_array((void **)&graph->changed, sizeof(bool), capacity) &&
+		shape_graph_resize_array((void **)&graph->opacities, sizeof(float), capacity);
+	if (!ok) {
+		fprintf(stderr, "Unable to allocate shape graph!\n");
+		return false;
+	}
+	graph->capacity = capacity;
+	return true;
+}
+
+bool shape_graph_add_subtree(shape_graph_t *graph, shape_t *shape, int parent) {
+	// A tree added to the scene twice is only updated and drawn once
+	if (shape->graph == graph) return true;
+	if (!shape_graph_reserve(graph, graph->count + 1)) return false;
+	
+	// Move the shape's state into the graph
+	const int index = graph->count++;
+	graph->nodes[index] = shape;
+	graph->parents[index] = parent;
+	graph->positions[index] = shape->position;
+	graph->linear_momenta[index] = shape->linear_momentum;
+	graph->rotations[index] = shape->rotation;
+	graph->angular_momenta[index] = shape->angular_momentum;
+	graph->previous_positions[index] = shape->position;
+	graph->previous_rotations[index] = shape->rotation;
+	graph->previous_visible[index] = false;
+	graph->local_transforms[index] = shape->local_transform;
+	graph->world_transforms[index] = shape->world_transform;
+	shape->graph = graph;
+	shape->graph_index = index;
+	
+	shape_t **a = shape->children.array;
+	int n = shape->children.length;
+	for (int i=0; i<n; i++) {
+		if (!shape_graph_add_subtree(graph, a[i], index)) return false;
+	}
+	graph->subtree_ends[index] = graph->count;
+	return true;
+}
+
+bool shape_graph_build(shape_graph_t *graph, shape_t **roots, int root_count) {
+	shape_graph_release(graph);
+	graph->tree_version = shape_tree_version;
+	for (int i = 0; i < root_count; i++) {
+		if (!shape_graph_add_subtree(graph, roots[i], -1)) {
+			shape_graph_release(graph);
+			return false;
 		}
 	}
+	return true;
+}
+
+void shape_graph_release(shape_graph_t *graph) {
+	// Move each node's state back into its shape
+	const int n = graph->count;
+	for (int i = 0; i < n; i++) {
+		shape_t *shape = graph->nodes[i];
+		shape->position = graph->positions[i];
+		shape->linear_momentum = graph->linear_momenta[i];
+		shape->rotation = graph->rotations[i];
+		shape->angular_momentum = graph->angular_momenta[i];
+		shape->local_transform = graph->local_transforms[i];
+		shape->world_transform = graph->world_transforms[i];
+		shape->graph = NULL;
+		shape->graph_index = -1;
+	}
+	graph->count = 0;
+}
+
+void shape_graph_save_previous(shape_graph_t *graph) {
+	// Called at the start of each update step, before anything moves the shapes
+	const int n = graph->count;
+	for (int i = 0; i < n; i++) {
+		graph->previous_positions[i] = graph->positions[i];
+		graph->previous_rotations[i] = graph->rotations[i];
+		graph->previous_visible[i] = graph->nodes[i]->is_visible;
+	}
+}
+
+void shape_graph_update(shape_graph_t *graph, double delta_time) {
+	// Integrate all shapes at once, same as calling shape_update() on each root
+	const int n = graph->count;
+	const float dt = (float)delta_time;
+	physics_integrate((float *)graph->positions, (const float *)graph->linear_momenta, n * 2, dt);
+	physics_integrate(graph->rotations, graph->angular_momenta, n, dt);
 	
-	// Children
-	if (shape->children) {
-		shape_t **a = (shape_t **)shape->children->array;
-		int n = shape->children->length;
-		for (int i=0; i<n; i++) {
-			shape_draw_recursive(a[i], transform, opacity);
+	// Only moving shapes need their transforms recalculated
+	for (int i = 0; i < n; i++) {
+		shape_t *shape = graph->nodes[i];
+		if (!vec2_is_zero(graph->linear_momenta[i]) || graph->angular_momenta[i] != 0.0f) {
+			shape->transform_dirty = true;
 		}
+		shape->lifetime += delta_time;
 	}
 }
 
+void shape_graph_draw(shape_graph_t *graph, float interpolation) {
+	// Same result as calling shape_draw() on each root in order
+	const int n = graph->count;
+	int i = 0;
+	while (i < n) {
+		shape_t *shape = graph->nodes[i];
+		const int parent = graph->parents[i];
+		const bool parent_changed = parent >= 0 && graph->changed[parent];
+		
+		if (!shape->is_visible) {
+			// Skip the subtree, and recalculate its world transform once the shape is shown again
+			if (parent_changed) shape->transform_dirty = true;
+			i = graph->subtree_ends[i];
+			continue;
+		}
+		
+		// Between update steps, shapes that moved during the last step are drawn part way
+		// from where they were at its start. Their transforms are recalculated next frame.
+		const vec2_t position = graph->positions[i];
+		const float rotation = graph->rotations[i];
+		const vec2_t previous_position = graph->previous_positions[i];
+		const float previous_rotation = graph->previous_rotations[i];
+		const bool interpolate = interpolation < 1.0f && graph->previous_visible[i] &&
+			(!vec2_is_zero(vec2_sub(position, previous_position)) || rotation != previous_rotation);
+		
+		const bool changed = parent_changed || shape->transform_dirty || interpolate;
+		if (interpolate) {
+			const vec2_t p = vec2_add(previous_position, vec2_mul(vec2_sub(position, previous_position), interpolation));
+			const float r = previous_rotation + (rotation - previous_rotation) * interpolation;
+			graph->local_transforms[i] = affine2_make(p, r, shape->scale);
+			shape->transform_dirty = true;
+		} else if (shape->transform_dirty) {
+			graph->local_transforms[i] = affine2_make(position, rotation, shape->scale);
+			shape->transform_dirty = false;
+		}
+		if (changed) {
+			if (parent >= 0) {
+				graph->world_transforms[i] = affine2_multiply(graph->world_transforms[parent], graph->local_transforms[i]);
+			} else {
+				graph->world_transforms[i] = graph->local_transforms[i];
+			}
+		}
+		graph->changed[i] = changed;
+		
+		const float opacity = (parent >= 0? graph->opacities[parent] : 1.0f) * shape->opacity;
+		graph->opacities[i] = opacity;
+		shape_draw_points(shape, &graph->world_transforms[i], opacity);
+		i++;
+	}
+}
@@ -10,17 +10,28 @@
 
 #include "matrix.h"
 #include "vector.h"
-#include "array_list.h"
-#include "point_list.h"
+#include "arena.h"
+#include "dynamic_array.h"
 
 #include <stdbool.h>
 
 
-typedef struct {
+DYNAMIC_ARRAY(point_list, vec2_t, 8)
+DYNAMIC_ARRAY(shape_list, struct shape_s *, 2)
+
+typedef struct shape_s {
+	arena_t *arena; // owner of this shape and its arrays, NULL for heap
+	
 	// Geometry
-	point_list_t *points;
+	point_list_t points;
 	bool is_closed;
-	array_list_t *children;
+	shape_list_t children;
+	
+	// Level of detail
+	struct shape_s *lower_detail; // points drawn instead when smaller than lod_min_screen_radius
+	float lod_min_screen_radius; // pixels
+	float lod_bounding_radius; // object space
+	int lod_level; // currently drawn level, 0 = this shape
 	
 	// Visuals
 	bool is_visible;
@@ -28,13 +39,23 @@ typedef struct {
 	uint32_t fill_color;
 	float opacity;
 	
-	// Physics
+	// Physics. While the shape is a node of a graph, position, momentum and rotation
+	// are stored in the graph instead, so use the accessors below.
 	vec2_t scale;
 	vec2_t position; // meters
 	vec2_t linear_momentum; // meters/second
 	float rotation; // radians
 	float angular_momentum; // radians/second
 	double lifetime;
+	
+	// Cached transforms, also stored in the graph while the shape is a node
+	affine2_t local_transform;
+	affine2_t world_transform;
+	bool transform_dirty;
+	
+	// Graph that owns this shape's physics and transforms, or NULL
+	struct shape_graph_s *graph;
+	int graph_index;
 } shape_t;
 
 
@@ -42,11 +63,62 @@ shape_t *shape_new(int initial_capacity);
 void shape_destroy(shape_t *shape);
 
 bool shape_add_point(shape_t *shape, vec2_t point);
-bool shape_add_points(shape_t *shape, point_list_t *points);
+bool shape_add_points(shape_t *shape, const vec2_t *points, int n);
 bool shape_add_child(shape_t *shape, shape_t *child);
+void shape_set_lower_detail(shape_t *shape, shape_t *lower_detail, float min_screen_radius);
+
+void shape_set_position(shape_t *shape, vec2_t position);
+void shape_set_rotation(shape_t *shape, float rotation);
+void shape_set_scale(shape_t *shape, vec2_t scale);
+void shape_set_linear_momentum(shape_t *shape, vec2_t momentum);
+void shape_set_angular_momentum(shape_t *shape, float momentum);
+vec2_t shape_get_position(const shape_t *shape);
+float shape_get_rotation(const shape_t *shape);
+vec2_t shape_get_linear_momentum(const shape_t *shape);
+float shape_get_angular_momentum(const shape_t *shape);
 
 void shape_update(shape_t *shape, double delta_time);
+void shape_integrate(shape_t *shape, double delta_time); // without children
 void shape_draw(shape_t *shape);
-void shape_draw_recursive(shape_t *shape, mat3_t transform, float opacity);
+void shape_draw_recursive(shape_t *shape, const affine2_t *parent_transform, bool parent_changed, float opacity);
+
+// Shape trees in depth first order, the 2D counterpart of mesh_graph_t. It owns its
+// nodes' physics and cached transforms in the same way.
+typedef struct shape_graph_s {
+	int count;
+	int capacity;
+	uint32_t tree_version; // shape_tree_version when built
+	shape_t **nodes;
+	int *parents; // -1 for roots
+	int *subtree_ends; // index after the node's last descendant
+	
+	// Physics
+	vec2_t *positions;
+	vec2_t *linear_momenta;
+	float *rotations;
+	float *angular_momenta;
+	
+	// State at the start of the last update step, for drawing in between steps
+	vec2_t *previous_positions;
+	float *previous_rotations;
+	bool *previous_visible;
+	
+	// Drawing
+	affine2_t *local_transforms;
+	affine2_t *world_transforms;
+	bool *changed;
+	float *opacities;
+} shape_graph_t;
+
+// Incremented whenever children are added, so graphs know to rebuild
+extern _Thread_local uint32_t shape_tree_version;
+
+void shape_graph_init(shape_graph_t *graph);
+void shape_graph_free(shape_graph_t *graph);
+bool shape_graph_build(shape_graph_t *graph, shape_t **roots, int root_count);
+void shape_graph_release(shape_graph_t *graph); // give the nodes their state back
+void shape_graph_save_previous(shape_graph_t *graph);
+void shape_graph_update(shape_graph_t *graph, double delta_time);
+void shape_graph_draw(shape_graph_t *graph, float interpolation);
 
 #endif /* shape_h */
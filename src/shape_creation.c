@@ -10,8 +10,7 @@
 #include "color.h"
 #include "matrix.h"
 #include "vector.h"
-#include "array_list.h"
-#include "point_list.h"
+#include "arena.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -20,19 +19,21 @@
 #define RADIANF ((float)(M_PI * 2.0))
 
 
-point_list_t *create_circle_arc_points(vec2_t center, float radius, float start_angle, float end_angle, int n) {
-	point_list_t *pl = point_list_new(n);
-	if (pl) {
+vec2_t *create_circle_arc_points(vec2_t center, float radius, float start_angle, float end_angle, int n) {
+	// Returns the n - 1 points between the ends of an arc of n segments.
+	// The points are allocated from the frame arena and are only valid until the next frame.
+	vec2_t *points = arena_alloc(&frame_arena, sizeof(vec2_t) * (size_t)n);
+	if (points) {
 		float angle_range = end_angle - start_angle;
 		for (int i = 1; i < n; i++) {
 			float angle = (float)i / (float)n * angle_range + start_angle;
 			vec2_t pt;
 			pt.x = center.x + cosf(angle) * radius;
 			pt.y = center.y + sinf(angle) * radius;
-			point_list_add(pl, pt);
+			points[i - 1] = pt;
 		}
 	}
-	return pl;
+	return points;
 }
 
 #pragma mark -
@@ -53,45 +54,70 @@ shape_t *create_rectangle_shape(float w, float h) {
 	return s;
 }
 
-shape_t *create_rounded_rect_shape(float w, float h, float radius) {
-	shape_t *s = shape_new(32);
+#pragma mark - Level of Detail
+
+// Arcs are drawn with fewer segments once their segments would be shorter than this on screen
+#define ARC_LOD_MIN_SEGMENT_LENGTH (4.0f)
+
+float arc_lod_min_screen_radius(float arc_radius, float arc_angle, int segments, float bounding_radius) {
+	// Screen radius of the whole shape at which each arc segment is ARC_LOD_MIN_SEGMENT_LENGTH pixels long
+	return ARC_LOD_MIN_SEGMENT_LENGTH * (float)segments * bounding_radius / (arc_radius * fabsf(arc_angle));
+}
+
+#pragma mark -
+
+shape_t *create_rounded_rect_shape_with_segments(float w, float h, float radius, int segments) {
+	shape_t *s = shape_new(segments * 4);
 	if (!s) return NULL;
 	s->is_closed = true;
 	
-	point_list_t *arc;
+	vec2_t *arc;
 	vec2_t center;
 	
 	// Top left corner
 	center.x = -w / 2 + radius;
 	center.y = -h / 2 + radius;
-	arc = create_circle_arc_points(center, radius, 0.25f * RADIANF, 0.5f * RADIANF, 8);
-	shape_add_points(s, arc);
-	point_list_destroy(arc);
+	arc = create_circle_arc_points(center, radius, 0.25f * RADIANF, 0.5f * RADIANF, segments);
+	if (arc) shape_add_points(s, arc, segments - 1);
 	
 	// Bottom left corner
 	center.x = -w / 2 + radius;
 	center.y = h / 2 - radius;
-	arc = create_circle_arc_points(center, radius, 0.5f * RADIANF, 0.75f * RADIANF, 8);
-	shape_add_points(s, arc);
-	point_list_destroy(arc);
+	arc = create_circle_arc_points(center, radius, 0.5f * RADIANF, 0.75f * RADIANF, segments);
+	if (arc) shape_add_points(s, arc, segments - 1);
 	
 	// Bottom right corner
 	center.x = w / 2 - radius;
 	center.y = h / 2 - radius;
-	arc = create_circle_arc_points(center, radius, 0.75f * RADIANF, 1.0f * RADIANF, 8);
-	shape_add_points(s, arc);
-	point_list_destroy(arc);
+	arc = create_circle_arc_points(center, radius, 0.75f * RADIANF, 1.0f * RADIANF, segments);
+	if (arc) shape_add_points(s, arc, segments - 1);
 	
 	// Top right corner
 	center.x = w / 2 - radius;
 	center.y = -h / 2 + radius;
-	arc = create_circle_arc_points(center, radius, 0.0f * RADIANF, 0.25f * RADIANF, 8);
-	shape_add_points(s, arc);
-	point_list_destroy(arc);
+	arc = create_circle_arc_points(center, radius, 0.0f * RADIANF, 0.25f * RADIANF, segments);
+	if (arc) shape_add_points(s, arc, segments - 1);
 
 	return s;
 }
 
+shape_t *create_rounded_rect_shape(float w, float h, float radius) {
+	const int segments = 8;
+	shape_t *s = create_rounded_rect_shape_with_segments(w, h, radius, segments);
+	if (!s) return NULL;
+	
+	// Lower levels of detail with fewer segments per corner
+	const float bounding_radius = sqrtf(w * w + h * h) / 2;
+	shape_t *lod = s;
+	for (int n = segments; n > 2; n /= 2) {
+		shape_t *lower = create_rounded_rect_shape_with_segments(w, h, radius, n / 2);
+		if (!lower) break;
+		shape_set_lower_detail(lod, lower, arc_lod_min_screen_radius(radius, 0.25f * RADIANF, n, bounding_radius));
+		lod = lower;
+	}
+	return s;
+}
+
 shape_t *create_polygon_shape(int sides, float radius) {
 	/* Creates a n-sided polygon starting from (1, 0) and going clockwise,
 	   assuming a coordinate system with positive y is down.
@@ -119,9 +145,8 @@ shape_t *create_star_shape(int points, float radius, float indent) {
 	return s;
 }
 
-shape_t *create_heart_shape(void) {
-	const int sides = 32;
-	shape_t *s = shape_new(sides);
+shape_t *create_heart_shape_with_segments(int segments) {
+	shape_t *s = shape_new(segments * 2 + 2);
 	if (!s) return NULL;
 	s->is_closed = true;
 	
@@ -132,23 +157,37 @@ shape_t *create_heart_shape(void) {
 	vec2_t center = { .x = 0.325f, .y = 0.125f };
 	float start_angle = RADIANF * -0.125f;
 	float end_angle = RADIANF * 0.5f;
-	point_list_t *arc = create_circle_arc_points(center, 0.333f, start_angle, end_angle, 15);
+	vec2_t *arc = create_circle_arc_points(center, 0.333f, start_angle, end_angle, segments);
+	if (!arc) return s;
 	
 	// Add non-mirrored arc
-	shape_add_points(s, arc);
+	shape_add_points(s, arc, segments - 1);
 	
 	// Add mirrored arc
 	mat3_t mirror = mat3_scale(mat3_identity(), vec2_make(-1.0f, 1.0f));
-	for (int i = arc->length - 1; i >= 0; i--) {
-		shape_add_point(s, vec2_mat3_multiply(arc->array[i], mirror));
+	for (int i = segments - 2; i >= 0; i--) {
+		shape_add_point(s, vec2_mat3_multiply(arc[i], mirror));
 	}
-	
-	// Dispose of arc
-	point_list_destroy(arc);
 
 	return s;
 }
 
+shape_t *create_heart_shape(void) {
+	const int segments = 15;
+	shape_t *s = create_heart_shape_with_segments(segments);
+	if (!s) return NULL;
+	
+	// Lower levels of detail with fewer segments per arc
+	shape_t *lod = s;
+	for (int n = segments; n > 3; n /= 2) {
+		shape_t *lower = create_heart_shape_with_segments(n / 2);
+		if (!lower) break;
+		shape_set_lower_detail(lod, lower, arc_lod_min_screen_radius(0.333f, 0.625f * RADIANF, n, 0.75f));
+		lod = lower;
+	}
+	return s;
+}
+
 shape_t *create_crescent_moon_shape(void) {
 	const int sides = 32;
 	shape_t *s = shape_new(sides);
@@ -329,7 +368,7 @@ shape_t *create_microphone_shape(void) {
 			shape_add_point(mic, pt);
 		}
 		// Add mirrored points
-		vec2_t *p = mic->points->array;
+		vec2_t *p = mic->points.array;
 		for (int i=0; i<n; i++) {
 			shape_add_point(mic, vec2_mat3_multiply(p[n - i - 1], mirror));
 		}
@@ -360,7 +399,7 @@ shape_t *create_microphone_shape(void) {
 			shape_add_point(lower_band, pt);
 		}
 		// Add mirrored points
-		vec2_t *p = lower_band->points->array;
+		vec2_t *p = lower_band->points.array;
 		for (int i=0; i<n; i++) {
 			shape_add_point(lower_band, vec2_mat3_multiply(p[n - i - 1], mirror));
 		}
@@ -396,7 +435,7 @@ shape_t *create_stand_shape(void) {
 		shape_add_point(s, pt);
 	}
 	// Add mirrored points
-	vec2_t *p = s->points->array;
+	vec2_t *p = s->points.array;
 	for (int i=0; i<n; i++) {
 		shape_add_point(s, vec2_mat3_multiply(p[n - i - 1], mirror));
 	}
@@ -532,22 +571,37 @@ shape_t *create_lighting_bolt_shape(void) {
 	return s;
 }
 
-shape_t *create_smoke_circle_shape(void) {
-	shape_t *s = shape_new(6);
+shape_t *create_smoke_circle_shape_with_segments(int segments) {
+	shape_t *s = shape_new(segments);
 	if (!s) return NULL;
 	s->line_color = rgb_to_abgr(COLOR_RGB_GRAY_20);
 	s->fill_color = rgba_to_abgr(COLOR_RGB_GRAY_50, 127);
 	s->is_closed = false;
 
 	// Arc
-	point_list_t *arc = create_circle_arc_points(vec2_zero(), 0.2f, -0.125f * RADIANF, 0.625f * RADIANF, 24);
-	shape_add_points(s, arc);
-	point_list_destroy(arc);
+	vec2_t *arc = create_circle_arc_points(vec2_zero(), 0.2f, -0.125f * RADIANF, 0.625f * RADIANF, segments);
+	if (arc) shape_add_points(s, arc, segments - 1);
 	
 	return s;
 
 }
 
+shape_t *create_smoke_circle_shape(void) {
+	const int segments = 24;
+	shape_t *s = create_smoke_circle_shape_with_segments(segments);
+	if (!s) return NULL;
+	
+	// Lower levels of detail with fewer segments
+	shape_t *lod = s;
+	for (int n = segments; n > 6; n /= 2) {
+		shape_t *lower = create_smoke_circle_shape_with_segments(n / 2);
+		if (!lower) break;
+		shape_set_lower_detail(lod, lower, arc_lod_min_screen_radius(0.2f, 0.75f * RADIANF, n, 0.2f));
+		lod = lower;
+	}
+	return s;
+}
+
 #pragma mark -
 
 shape_t *create_toemaniac_shape(void) {
@@ -0,0 +1,102 @@
+//
+//  slot_map.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "slot_map.h"
+
+#include <stdio.h>
+
+
+void slot_map_init(slot_map_t *map) {
+	slot_map_slots_init(&map->slots, NULL);
+	slot_map_values_init(&map->values, NULL);
+	slot_map_indexes_init(&map->value_slots, NULL);
+	map->free_slot = -1;
+}
+
+void slot_map_free(slot_map_t *map) {
+	slot_map_slots_free(&map->slots);
+	slot_map_values_free(&map->values);
+	slot_map_indexes_free(&map->value_slots);
+	map->free_slot = -1;
+}
+
+slot_handle_t slot_map_insert(slot_map_t *map, void *value) {
+	// Make room first so that a failed allocation leaves the map unchanged
+	const int length = map->values.length;
+	if (!slot_map_values_reserve(&map->values, length + 1) ||
+		!slot_map_indexes_reserve(&map->value_slots, length + 1)) {
+		fprintf(stderr, "Unable to allocate slot map values!\n");
+		return SLOT_HANDLE_NULL;
+	}
+	
+	// Reuse a free slot, or add a new one
+	int index = map->free_slot;
+	if (index >= 0) {
+		map->free_slot = map->slots.array[index].dense_index;
+	} else {
+		slot_map_slot_t slot = { 1, -1 };
+		if (!slot_map_slots_add(&map->slots, slot)) {
+			fprintf(stderr, "Unable to allocate slot map slot!\n");
+			return SLOT_HANDLE_NULL;
+		}
+		index = map->slots.length - 1;
+	}
+	
+	slot_map_slot_t *slot = &map->slots.array[index];
+	slot->dense_index = length;
+	slot_map_values_add(&map->values, value);
+	slot_map_indexes_add(&map->value_slots, index);
+	
+	slot_handle_t handle = { (uint32_t)index, slot->generation };
+	return handle;
+}
+
+slot_map_slot_t *slot_map_find_slot(const slot_map_t *map, slot_handle_t handle) {
+	if (handle.index >= (uint32_t)map->slots.length) return NULL;
+	slot_map_slot_t *slot = &map->slots.array[handle.index];
+	if (slot->generation != handle.generation) return NULL;
+	return slot;
+}
+
+void slot_map_release_slot(slot_map_t *map, int index) {
+	// Invalidate outstanding handles, skipping 0 when the generation wraps around
+	slot_map_slot_t *slot = &map->slots.array[index];
+	slot->generation++;
+	if (slot->generation == 0) slot->generation = 1;
+	slot->dense_index = map->free_slot;
+	map->free_slot = index;
+}
+
+bool slot_map_remove(slot_map_t *map, slot_handle_t handle) {
+	slot_map_slot_t *slot = slot_map_find_slot(map, handle);
+	if (!slot) return false;
+	
+	// Move the last value into the hole
+	const int dense_index = slot->dense_index;
+	const int last = map->values.length - 1;
+	if (dense_index != last) {
+		const int moved_slot = map->value_slots.array[last];
+		map->slots.array[moved_slot].dense_index = dense_index;
+	}
+	slot_map_values_remove_at(&map->values, dense_index);
+	slot_map_indexes_remove_at(&map->value_slots, dense_index);
+	slot_map_release_slot(map, (int)handle.index);
+	return true;
+}
+
+void slot_map_remove_all(slot_map_t *map) {
+	for (int i = 0; i < map->values.length; i++) {
+		slot_map_release_slot(map, map->value_slots.array[i]);
+	}
+	slot_map_values_remove_all(&map->values);
+	slot_map_indexes_remove_all(&map->value_slots);
+}
+
+void *slot_map_get(const slot_map_t *map, slot_handle_t handle) {
+	const slot_map_slot_t *slot = slot_map_find_slot(map, handle);
+	return slot? map->values.array[slot->dense_index] : NULL;
+}
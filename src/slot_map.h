@@ -0,0 +1,49 @@
+//
+//  slot_map.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Unordered set of pointers with O(1) insert, remove and lookup by handle.
+// Values are kept packed in a dense array for iteration. Each handle carries
+// the generation of its slot, so a handle to a removed value stays invalid
+// even after the slot is reused.
+
+#ifndef slot_map_h
+#define slot_map_h
+
+#include "dynamic_array.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t index;
+	uint32_t generation; // 0 is never used, so a zeroed handle is always invalid
+} slot_handle_t;
+
+#define SLOT_HANDLE_NULL ((slot_handle_t){ 0, 0 })
+
+typedef struct {
+	uint32_t generation;
+	int dense_index; // position in values while in use, otherwise the next free slot or -1
+} slot_map_slot_t;
+
+DYNAMIC_ARRAY(slot_map_slots, slot_map_slot_t, 16)
+DYNAMIC_ARRAY(slot_map_values, void *, 16)
+DYNAMIC_ARRAY(slot_map_indexes, int, 16)
+
+typedef struct {
+	slot_map_slots_t slots;
+	int free_slot; // head of the free slot list, or -1
+	slot_map_values_t values; // dense, in no particular order once values are removed
+	slot_map_indexes_t value_slots; // slot of each value
+} slot_map_t;
+
+void slot_map_init(slot_map_t *map);
+void slot_map_free(slot_map_t *map);
+slot_handle_t slot_map_insert(slot_map_t *map, void *value);
+bool slot_map_remove(slot_map_t *map, slot_handle_t handle);
+void slot_map_remove_all(slot_map_t *map);
+void *slot_map_get(const slot_map_t *map, slot_handle_t handle);
+
+#endif /* slot_map_h */
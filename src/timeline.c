@@ -0,0 +1,650 @@
+//
+//  timeline.c
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+
+#include "timeline.h"
+#include "dynamic_array.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define TIMELINE_MAGIC (0x4C4D4954) // "TIML"
+#define TIMELINE_VERSION (4)
+#define TIMELINE_NAME_LENGTH (32)
+#define TIMELINE_PATH_LENGTH (1024)
+#define TIMELINE_MAX_TOKENS (8)
+
+// Same order as event_commands and the built in easing curves
+const char *const timeline_command_names[] = {
+	"EndSequence",
+	"ShowShape",
+	"ShowMesh",
+	"SetShapeOpacity",
+	"SetMeshOpacity",
+	"MoveShape",
+	"MoveMesh",
+	"RotateShape",
+	"RotateMesh",
+	"ScaleShape",
+	"ScaleMesh",
+	"EmitParticles",
+};
+#define TIMELINE_COMMAND_COUNT ((int)(sizeof(timeline_command_names) / sizeof(timeline_command_names[0])))
+
+const char *const timeline_easing_names[] = {
+	"EaseLinear",
+	"EaseInQuad",
+	"EaseOutQuad",
+	"EaseInCubic",
+	"EaseOutCubic",
+	"EaseOutBounce",
+	"EaseOutElastic",
+	"EaseBezier",
+};
+#define TIMELINE_EASING_COUNT ((int)(sizeof(timeline_easing_names) / sizeof(timeline_easing_names[0])))
+
+// Start of the cache file. The events follow, ending with an EndSequence event,
+// and then the curves and the tempo segments.
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t names_hash; // the names that the cached indexes refer to
+	uint32_t event_count; // not including EndSequence
+	uint32_t curve_count;
+	uint32_t segment_count;
+	uint32_t beats_per_bar;
+	uint32_t reserved;
+	int64_t source_size;
+	uint64_t source_hash; // FNV-1a of the source text, since edits can land within one mtime tick
+} timeline_header_t;
+
+// A time as seconds plus a position in beats and bars, which only becomes
+// seconds once all the tempos have been read
+typedef struct {
+	double seconds;
+	double beats;
+	double bars;
+	bool on_beats; // has a beat or bar term
+} timeline_time_t;
+
+typedef struct {
+	char name[TIMELINE_NAME_LENGTH];
+	timeline_time_t value;
+} timeline_variable_t;
+
+typedef struct {
+	char name[TIMELINE_NAME_LENGTH];
+	easing_bezier_t curve;
+} timeline_curve_t;
+
+DYNAMIC_ARRAY(timeline_variable_list, timeline_variable_t, 16)
+DYNAMIC_ARRAY(timeline_curve_list, timeline_curve_t, 8)
+DYNAMIC_ARRAY(timeline_event_list, sequence_event, 64)
+DYNAMIC_ARRAY(timeline_time_list, timeline_time_t, 128)
+DYNAMIC_ARRAY(timeline_tempo_list, beat_segment_t, 8)
+
+// Everything read so far from a timeline's text
+typedef struct {
+	timeline_variable_list_t variables;
+	timeline_curve_list_t curves;
+	timeline_event_list_t events;
+	timeline_time_list_t times; // start and end of each event
+	timeline_tempo_list_t tempos;
+	double offset; // seconds at beat 0
+	int beats_per_bar;
+	const timeline_targets_t *targets;
+	const char *path;
+} timeline_parser_t;
+
+
+#pragma mark - Names
+
+int timeline_find_name(const char *const *names, int count, const char *name) {
+	for (int i = 0; i < count; i++) {
+		if (strcmp(names[i], name) == 0) return i;
+	}
+	return -1;
+}
+
+uint32_t timeline_hash_names(uint32_t hash, const char *const *names, int count) {
+	// FNV-1a, including each name's terminating zero
+	for (int i = 0; i < count; i++) {
+		const char *s = names[i];
+		do {
+			hash ^= (uint8_t)*s;
+			hash *= 16777619u;
+		} while (*s++ != 0);
+	}
+	return hash;
+}
+
+uint64_t timeline_hash_text(const char *text, size_t length) {
+	uint64_t hash = 14695981039346656037u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint8_t)text[i];
+		hash *= 1099511628211u;
+	}
+	return hash;
+}
+
+uint32_t timeline_names_hash(const timeline_targets_t *targets) {
+	uint32_t hash = 2166136261u;
+	hash = timeline_hash_names(hash, timeline_command_names, TIMELINE_COMMAND_COUNT);
+	hash = timeline_hash_names(hash, timeline_easing_names, TIMELINE_EASING_COUNT);
+	hash = timeline_hash_names(hash, targets->mesh_names, targets->mesh_count);
+	hash = timeline_hash_names(hash, targets->shape_names, targets->shape_count);
+	hash = timeline_hash_names(hash, targets->emitter_names, targets->emitter_count);
+	hash ^= (uint32_t)sizeof(sequence_event);
+	hash *= 16777619u;
+	return hash;
+}
+
+
+#pragma mark - Parsing
+
+bool timeline_eval_time(const char *s, const timeline_variable_list_t *variables, timeline_time_t *result) {
+	// Sum of numbers and variables, such as "T0+1.5" or "SONG_DURATION-1".
+	// Numbers ending in "b" are beats, and numbers ending in "bar" are bars.
+	timeline_time_t sum = { 0.0, 0.0, 0.0, false };
+	double sign = 1.0;
+	while (true) {
+		timeline_time_t term = { 0.0, 0.0, 0.0, false };
+		if (isalpha((unsigned char)*s) || *s == '_') {
+			const char *name = s;
+			while (isalnum((unsigned char)*s) || *s == '_') {
+				s++;
+			}
+			size_t length = (size_t)(s - name);
+			int found = -1;
+			for (int i = 0; i < variables->length; i++) {
+				const char *v = variables->array[i].name;
+				if (strlen(v) == length && strncmp(v, name, length) == 0) {
+					found = i;
+					break;
+				}
+			}
+			if (found < 0) return false;
+			term = variables->array[found].value;
+		} else {
+			char *end;
+			double x = strtod(s, &end);
+			if (end == s) return false;
+			s = end;
+			if (strncmp(s, "bar", 3) == 0) {
+				term.bars = x;
+				term.on_beats = true;
+				s += 3;
+			} else if (*s == 'b') {
+				term.beats = x;
+				term.on_beats = true;
+				s++;
+			} else {
+				term.seconds = x;
+			}
+		}
+		sum.seconds += sign * term.seconds;
+		sum.beats += sign * term.beats;
+		sum.bars += sign * term.bars;
+		sum.on_beats = sum.on_beats || term.on_beats;
+
+		if (*s == 0) break;
+		if (*s == '+') {
+			sign = 1.0;
+		} else if (*s == '-') {
+			sign = -1.0;
+		} else {
+			return false;
+		}
+		s++;
+	}
+	*result = sum;
+	return true;
+}
+
+bool timeline_eval(const char *s, const timeline_variable_list_t *variables, double *result) {
+	// A plain number, without beats or bars
+	timeline_time_t time;
+	if (!timeline_eval_time(s, variables, &time) || time.on_beats) return false;
+	*result = time.seconds;
+	return true;
+}
+
+int timeline_eval_list(char *s, const timeline_variable_list_t *variables, float *c, int max) {
+	// Up to max comma separated values. Returns how many there were, or -1 if invalid.
+	for (int i = 0; i < max; i++) {
+		char *comma = strchr(s, ',');
+		if (comma) *comma = 0;
+		double x;
+		if (!timeline_eval(s, variables, &x)) return -1;
+		c[i] = (float)x;
+		if (!comma) return i + 1;
+		s = comma + 1;
+	}
+	return -1;
+}
+
+bool timeline_eval_vector(char *s, const timeline_variable_list_t *variables, vec3_t *result) {
+	// Up to three components, missing components are 0
+	float c[3] = { 0.0f, 0.0f, 0.0f };
+	if (timeline_eval_list(s, variables, c, 3) < 0) return false;
+	*result = vec3_make(c[0], c[1], c[2]);
+	return true;
+}
+
+bool timeline_set_variable(timeline_variable_list_t *variables, const char *name, timeline_time_t value) {
+	if (strlen(name) >= TIMELINE_NAME_LENGTH) return false;
+	for (int i = 0; i < variables->length; i++) {
+		if (strcmp(variables->array[i].name, name) == 0) {
+			variables->array[i].value = value;
+			return true;
+		}
+	}
+	timeline_variable_t variable = { .value = value };
+	strcpy(variable.name, name);
+	return timeline_variable_list_add(variables, variable);
+}
+
+int timeline_find_curve(const timeline_curve_list_t *curves, const char *name) {
+	for (int i = 0; i < curves->length; i++) {
+		if (strcmp(curves->array[i].name, name) == 0) return i;
+	}
+	return -1;
+}
+
+bool timeline_parse_line(timeline_parser_t *parser, char *line, int line_number) {
+	const char *path = parser->path;
+	const timeline_targets_t *targets = parser->targets;
+	// Split into words, ignoring comments
+	char *comment = strchr(line, '#');
+	if (comment) *comment = 0;
+	char *tokens[TIMELINE_MAX_TOKENS];
+	int n = 0;
+	char *save = NULL;
+	for (char *s = strtok_r(line, " \t\r", &save); s; s = strtok_r(NULL, " \t\r", &save)) {
+		if (n == TIMELINE_MAX_TOKENS) {
+			fprintf(stderr, "%s:%d: Too many values!\n", path, line_number);
+			return false;
+		}
+		tokens[n++] = s;
+	}
+	if (n == 0) return true;
+
+	// set NAME value
+	if (strcmp(tokens[0], "set") == 0) {
+		timeline_time_t value;
+		if (n != 3 || !timeline_eval_time(tokens[2], &parser->variables, &value)) {
+			fprintf(stderr, "%s:%d: Expected set NAME value!\n", path, line_number);
+			return false;
+		}
+		if (!timeline_set_variable(&parser->variables, tokens[1], value)) {
+			fprintf(stderr, "%s:%d: Unable to set %s!\n", path, line_number, tokens[1]);
+			return false;
+		}
+		return true;
+	}
+
+	// tempo BEAT BPM
+	if (strcmp(tokens[0], "tempo") == 0) {
+		beat_segment_t segment = { 0.0, 0.0, 0.0 };
+		if (n != 3 || !timeline_eval(tokens[1], &parser->variables, &segment.beat) || !timeline_eval(tokens[2], &parser->variables, &segment.bpm) || segment.bpm <= 0.0) {
+			fprintf(stderr, "%s:%d: Expected tempo BEAT BPM!\n", path, line_number);
+			return false;
+		}
+		if (parser->tempos.length > 0 && segment.beat <= parser->tempos.array[parser->tempos.length - 1].beat) {
+			fprintf(stderr, "%s:%d: Tempos must be in order of beat!\n", path, line_number);
+			return false;
+		}
+		return timeline_tempo_list_add(&parser->tempos, segment);
+	}
+
+	// offset SECONDS, the time of beat 0
+	if (strcmp(tokens[0], "offset") == 0) {
+		if (n != 2 || !timeline_eval(tokens[1], &parser->variables, &parser->offset)) {
+			fprintf(stderr, "%s:%d: Expected offset SECONDS!\n", path, line_number);
+			return false;
+		}
+		return true;
+	}
+
+	// meter BEATS_PER_BAR
+	if (strcmp(tokens[0], "meter") == 0) {
+		double beats;
+		if (n != 2 || !timeline_eval(tokens[1], &parser->variables, &beats) || beats < 1.0 || beats != floor(beats)) {
+			fprintf(stderr, "%s:%d: Expected meter BEATS_PER_BAR!\n", path, line_number);
+			return false;
+		}
+		parser->beats_per_bar = (int)beats;
+		return true;
+	}
+
+	// curve NAME x1,y1,x2,y2
+	if (strcmp(tokens[0], "curve") == 0) {
+		float c[4];
+		timeline_curve_t curve;
+		if (n != 3 || strlen(tokens[1]) >= TIMELINE_NAME_LENGTH || timeline_eval_list(tokens[2], &parser->variables, c, 4) != 4) {
+			fprintf(stderr, "%s:%d: Expected curve NAME x1,y1,x2,y2!\n", path, line_number);
+			return false;
+		}
+		curve.curve = (easing_bezier_t){ c[0], c[1], c[2], c[3] };
+		if (!easing_bezier_is_valid(&curve.curve)) {
+			fprintf(stderr, "%s:%d: Curve x values must be from 0 to 1!\n", path, line_number);
+			return false;
+		}
+		if (timeline_find_name(timeline_easing_names, TIMELINE_EASING_COUNT, tokens[1]) >= 0 || timeline_find_curve(&parser->curves, tokens[1]) >= 0) {
+			fprintf(stderr, "%s:%d: Curve %s is already defined!\n", path, line_number, tokens[1]);
+			return false;
+		}
+		if (parser->curves.length >= EASING_MAX_CURVES) {
+			fprintf(stderr, "%s:%d: Too many curves!\n", path, line_number);
+			return false;
+		}
+		memset(curve.name, 0, sizeof(curve.name));
+		strcpy(curve.name, tokens[1]);
+		return timeline_curve_list_add(&parser->curves, curve);
+	}
+
+	// command target [easing] t0 t1 [p0] [p1]
+	sequence_event event;
+	memset(&event, 0, sizeof(event)); // padding too, so caches are reproducible
+	event.ease = EaseLinear;
+	int cmd = timeline_find_name(timeline_command_names, TIMELINE_COMMAND_COUNT, tokens[0]);
+	if (cmd <= EndSequence) {
+		fprintf(stderr, "%s:%d: Unknown command %s!\n", path, line_number, tokens[0]);
+		return false;
+	}
+	event.cmd = (event_commands)cmd;
+
+	int target = -1;
+	if (n > 1) {
+		switch (event.cmd) {
+			case ShowMesh:
+			case SetMeshOpacity:
+			case MoveMesh:
+			case RotateMesh:
+			case ScaleMesh:
+				target = timeline_find_name(targets->mesh_names, targets->mesh_count, tokens[1]);
+				break;
+			case EmitParticles:
+				target = timeline_find_name(targets->emitter_names, targets->emitter_count, tokens[1]);
+				break;
+			default:
+				target = timeline_find_name(targets->shape_names, targets->shape_count, tokens[1]);
+				break;
+		}
+	}
+	if (target < 0) {
+		fprintf(stderr, "%s:%d: Unknown target %s!\n", path, line_number, n > 1? tokens[1] : "");
+		return false;
+	}
+	event.target = (uint32_t)target;
+
+	int i = 2;
+	if (i < n) {
+		int ease = timeline_find_name(timeline_easing_names, TIMELINE_EASING_COUNT, tokens[i]);
+		int curve = timeline_find_curve(&parser->curves, tokens[i]);
+		if (ease >= 0) {
+			event.ease = (easing_curve)ease;
+			i++;
+		} else if (curve >= 0) {
+			event.ease = (easing_curve)(EaseCustom + curve);
+			i++;
+		}
+	}
+	timeline_time_t t0, t1;
+	if (n < i + 2 || n > i + 4 ||
+		!timeline_eval_time(tokens[i], &parser->variables, &t0) ||
+		!timeline_eval_time(tokens[i + 1], &parser->variables, &t1) ||
+		(i + 2 < n && !timeline_eval_vector(tokens[i + 2], &parser->variables, &event.p0)) ||
+		(i + 3 < n && !timeline_eval_vector(tokens[i + 3], &parser->variables, &event.p1))) {
+		fprintf(stderr, "%s:%d: Expected %s target [easing] start end [p0] [p1]!\n", path, line_number, tokens[0]);
+		return false;
+	}
+
+	// The times are set once the tempos are known
+	return timeline_event_list_add(&parser->events, event) &&
+		timeline_time_list_add(&parser->times, t0) &&
+		timeline_time_list_add(&parser->times, t1);
+}
+
+double timeline_time_seconds(const timeline_parser_t *parser, timeline_time_t time) {
+	if (!time.on_beats) return time.seconds;
+	double beat = time.beats + time.bars * parser->beats_per_bar;
+	return time.seconds + beat_segments_time_at(parser->tempos.array, parser->tempos.length, beat);
+}
+
+bool timeline_resolve_times(timeline_parser_t *parser) {
+	// Convert beats and bars to seconds, with the tempos from the whole file
+	if (parser->tempos.length > 0 && !beat_segments_set_times(parser->tempos.array, parser->tempos.length, parser->offset)) {
+		fprintf(stderr, "%s: The first tempo must be at beat 0!\n", parser->path);
+		return false;
+	}
+	for (int i = 0; i < parser->events.length; i++) {
+		timeline_time_t t0 = parser->times.array[i * 2];
+		timeline_time_t t1 = parser->times.array[i * 2 + 1];
+		if (parser->tempos.length == 0 && (t0.on_beats || t1.on_beats)) {
+			fprintf(stderr, "%s: Times in beats or bars need a tempo!\n", parser->path);
+			return false;
+		}
+		parser->events.array[i].t0 = timeline_time_seconds(parser, t0);
+		parser->events.array[i].t1 = timeline_time_seconds(parser, t1);
+	}
+	return true;
+}
+
+char *timeline_read_text(const char *path, size_t *length) {
+	// Returns NULL without an error message if the file is missing, since the cache may be used on its own
+	FILE *file = fopen(path, "rb");
+	if (!file) return NULL;
+	fseek(file, 0L, SEEK_END);
+	long file_length = ftell(file);
+	fseek(file, 0L, SEEK_SET);
+	char *text = file_length >= 0? malloc((size_t)file_length + 1) : NULL;
+	if (!text) {
+		fprintf(stderr, "Unable to allocate timeline text!\n");
+		fclose(file);
+		return NULL;
+	}
+	if (fread(text, 1, (size_t)file_length, file) != (size_t)file_length) {
+		fprintf(stderr, "Unable to read timeline %s!\n", path);
+		fclose(file);
+		free(text);
+		return NULL;
+	}
+	fclose(file);
+	text[file_length] = 0;
+	*length = (size_t)file_length;
+	return text;
+}
+
+bool timeline_parse(timeline_t *timeline, const char *path, char *text, const timeline_targets_t *targets) {
+	// The text is split into lines in place
+	bool success = true;
+	timeline_parser_t parser;
+	timeline_variable_list_init(&parser.variables, NULL);
+	timeline_curve_list_init(&parser.curves, NULL);
+	timeline_event_list_init(&parser.events, NULL);
+	timeline_time_list_init(&parser.times, NULL);
+	timeline_tempo_list_init(&parser.tempos, NULL);
+	parser.offset = 0.0;
+	parser.beats_per_bar = 4;
+	parser.targets = targets;
+	parser.path = path;
+
+	// Parse one line at a time
+	int line_number = 1;
+	char *line = text;
+	while (success && line) {
+		char *next = strchr(line, '\n');
+		if (next) *next++ = 0;
+		success = timeline_parse_line(&parser, line, line_number);
+		line = next;
+		line_number++;
+	}
+	success = success && timeline_resolve_times(&parser);
+
+	// Copy the events out, ending with EndSequence like the cache, followed by the curves and tempos
+	sequence_event *result = NULL;
+	if (success) {
+		const int event_count = parser.events.length;
+		const int curve_count = parser.curves.length;
+		const int segment_count = parser.tempos.length;
+		result = malloc(sizeof(sequence_event) * (event_count + 1) + sizeof(easing_bezier_t) * curve_count + sizeof(beat_segment_t) * segment_count);
+		if (result) {
+			memcpy(result, parser.events.array, sizeof(sequence_event) * event_count);
+			memset(&result[event_count], 0, sizeof(sequence_event)); // EndSequence
+			easing_bezier_t *result_curves = (easing_bezier_t *)&result[event_count + 1];
+			for (int i = 0; i < curve_count; i++) {
+				result_curves[i] = parser.curves.array[i].curve;
+			}
+			beat_segment_t *result_segments = (beat_segment_t *)&result_curves[curve_count];
+			memcpy(result_segments, parser.tempos.array, sizeof(beat_segment_t) * segment_count);
+			timeline->events = result;
+			timeline->event_count = event_count;
+			timeline->curves = result_curves;
+			timeline->curve_count = curve_count;
+			timeline->segments = result_segments;
+			timeline->segment_count = segment_count;
+			timeline->beats_per_bar = parser.beats_per_bar;
+			timeline->mapping = NULL;
+			timeline->mapping_size = 0;
+		} else {
+			fprintf(stderr, "Unable to allocate timeline events!\n");
+		}
+	}
+
+	timeline_variable_list_free(&parser.variables);
+	timeline_curve_list_free(&parser.curves);
+	timeline_event_list_free(&parser.events);
+	timeline_time_list_free(&parser.times);
+	timeline_tempo_list_free(&parser.tempos);
+	return result != NULL;
+}
+
+
+#pragma mark - Cache
+
+bool timeline_map_cache(timeline_t *timeline, const char *cache_path, bool has_source, size_t source_size, uint64_t source_hash, uint32_t names_hash) {
+	// Use the cache if it was compiled from the current source with the same names.
+	// Without a source, the cache is used on its own.
+	int fd = open(cache_path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat cache;
+	if (fstat(fd, &cache) != 0 || cache.st_size < (off_t)sizeof(timeline_header_t)) {
+		close(fd);
+		return false;
+	}
+	size_t size = (size_t)cache.st_size;
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) return false;
+
+	const timeline_header_t *header = mapping;
+	const sequence_event *events = (const sequence_event *)(header + 1);
+	bool valid = header->magic == TIMELINE_MAGIC &&
+		header->version == TIMELINE_VERSION &&
+		header->names_hash == names_hash &&
+		header->curve_count <= EASING_MAX_CURVES &&
+		size == sizeof(timeline_header_t) + sizeof(sequence_event) * ((size_t)header->event_count + 1) + sizeof(easing_bezier_t) * header->curve_count + sizeof(beat_segment_t) * header->segment_count &&
+		events[header->event_count].cmd == EndSequence;
+	if (valid && has_source) {
+		valid = header->source_size == (int64_t)source_size && header->source_hash == source_hash;
+	}
+	if (!valid) {
+		munmap(mapping, size);
+		return false;
+	}
+
+	timeline->events = events;
+	timeline->event_count = (int)header->event_count;
+	timeline->curves = (const easing_bezier_t *)&events[header->event_count + 1];
+	timeline->curve_count = (int)header->curve_count;
+	timeline->segments = (const beat_segment_t *)&timeline->curves[header->curve_count];
+	timeline->segment_count = (int)header->segment_count;
+	timeline->beats_per_bar = (int)header->beats_per_bar;
+	timeline->mapping = mapping;
+	timeline->mapping_size = size;
+	return true;
+}
+
+void timeline_write_cache(const timeline_t *timeline, const char *cache_path, size_t source_size, uint64_t source_hash, uint32_t names_hash) {
+	// Write to a temporary file and rename it over the cache, so a cache that
+	// is still mapped somewhere is never truncated underneath it
+	char temp_path[TIMELINE_PATH_LENGTH];
+	if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path) >= (int)sizeof(temp_path)) return;
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) {
+		fprintf(stderr, "Unable to write timeline cache %s.\n", cache_path);
+		return;
+	}
+
+	timeline_header_t header = {
+		.magic = TIMELINE_MAGIC,
+		.version = TIMELINE_VERSION,
+		.names_hash = names_hash,
+		.event_count = (uint32_t)timeline->event_count,
+		.curve_count = (uint32_t)timeline->curve_count,
+		.segment_count = (uint32_t)timeline->segment_count,
+		.beats_per_bar = (uint32_t)timeline->beats_per_bar,
+		.source_size = (int64_t)source_size,
+		.source_hash = source_hash,
+	};
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(timeline->events, sizeof(sequence_event), (size_t)timeline->event_count + 1, file) == (size_t)timeline->event_count + 1 &&
+		fwrite(timeline->curves, sizeof(easing_bezier_t), (size_t)timeline->curve_count, file) == (size_t)timeline->curve_count &&
+		fwrite(timeline->segments, sizeof(beat_segment_t), (size_t)timeline->segment_count, file) == (size_t)timeline->segment_count;
+	success = (fclose(file) == 0) && success;
+	if (!success || rename(temp_path, cache_path) != 0) {
+		fprintf(stderr, "Unable to write timeline cache %s.\n", cache_path);
+		remove(temp_path);
+	}
+}
+
+bool timeline_load(timeline_t *timeline, const char *path, const timeline_targets_t *targets) {
+	*timeline = (timeline_t){ NULL, 0, NULL, 0, NULL, 0, 4, NULL, 0 };
+
+	// The compiled cache sits next to the source, e.g. "song.timeline.bin"
+	char cache_path[TIMELINE_PATH_LENGTH];
+	if (snprintf(cache_path, sizeof(cache_path), "%s.bin", path) >= (int)sizeof(cache_path)) {
+		fprintf(stderr, "Timeline path is too long!\n");
+		return false;
+	}
+	size_t source_size = 0;
+	char *source = timeline_read_text(path, &source_size);
+	uint64_t source_hash = source? timeline_hash_text(source, source_size) : 0;
+	uint32_t names_hash = timeline_names_hash(targets);
+
+	if (timeline_map_cache(timeline, cache_path, source != NULL, source_size, source_hash, names_hash)) {
+		free(source);
+		return true;
+	}
+	if (!source) {
+		fprintf(stderr, "Unable to open timeline %s!\n", path);
+		return false;
+	}
+	bool success = timeline_parse(timeline, path, source, targets);
+	free(source);
+	if (success) {
+		timeline_write_cache(timeline, cache_path, source_size, source_hash, names_hash);
+	}
+	return success;
+}
+
+void timeline_free(timeline_t *timeline) {
+	if (timeline->mapping) {
+		munmap(timeline->mapping, timeline->mapping_size);
+	} else {
+		free((void *)timeline->events);
+	}
+	*timeline = (timeline_t){ NULL, 0, NULL, 0, NULL, 0, 4, NULL, 0 };
+}
@@ -0,0 +1,77 @@
+//
+//  timeline.h
+//  Toma Boxing
+//
+//  Created by agent on 10/19/26.
+//
+// Show timelines are text files listing sequencer events. The first load
+// compiles a timeline into a binary cache next to the text file, and later
+// loads map the cache straight into memory while the text is unchanged.
+
+#ifndef timeline_h
+#define timeline_h
+
+#include "beat_map.h"
+#include "easing.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sequencer operations
+
+typedef enum : uint32_t {
+	EndSequence,
+
+	ShowShape, 		// .p0: position (x, y), .p1:  rotation (.x: angle)
+	ShowMesh, 		// .p0: position, .p1: rotation
+	SetShapeOpacity, // .p0.x, .p1.x: opacity
+	SetMeshOpacity, // .p0.x, .p1.x: opacity
+
+	MoveShape, 		// .p0: starting position, .p1: ending position (in percent)
+	MoveMesh, 		// .p0: starting position, .p1: ending position
+	RotateShape, 	// .p0: starting rotation, .p1: ending rotation (in degrees)
+	RotateMesh, 	// .p0: starting rotation, .p1: ending rotation
+	ScaleShape,  	// .p0: starting scale, .p1: ending scale (in percent)
+	ScaleMesh, 		// .p0: starting scale, .p1: ending scale
+
+	EmitParticles,	// .target: emitter, .p0: position (same units as meshes)
+} event_commands;
+
+typedef struct {
+	event_commands cmd;
+	uint32_t target;
+	easing_curve ease; // from EaseCustom on, refers to the timeline's curves
+	double t0;
+	double t1;
+	vec3_t p0;
+	vec3_t p1;
+} sequence_event;
+
+// Names of the objects events can refer to, in index order
+typedef struct {
+	const char *const *mesh_names;
+	int mesh_count;
+	const char *const *shape_names;
+	int shape_count;
+	const char *const *emitter_names;
+	int emitter_count;
+} timeline_targets_t;
+
+typedef struct {
+	const sequence_event *events; // followed by an EndSequence event
+	int event_count;
+	const easing_bezier_t *curves; // defined with "curve NAME x1,y1,x2,y2"
+	int curve_count;
+	const beat_segment_t *segments; // defined with "tempo BEAT BPM", none if the show has no tempo
+	int segment_count;
+	int beats_per_bar;
+	void *mapping; // mapped cache file, or NULL if the events were parsed into the heap
+	size_t mapping_size;
+} timeline_t;
+
+bool timeline_load(timeline_t *timeline, const char *path, const timeline_targets_t *targets);
+void timeline_free(timeline_t *timeline);
+
+#endif /* timeline_h */
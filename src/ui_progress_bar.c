@@ -12,7 +12,7 @@
 
 
 // Globals
-double ui_progress_value = 0.0f;
+_Thread_local double ui_progress_value = 0.0f;
 
 void progress_bar_init(void) {
 	
@@ -61,6 +61,10 @@ float vec2_cross(vec2_t a, vec2_t b) {
 	return a.x * b.y - a.y * b.x;
 }
 
+bool vec2_is_zero(vec2_t a) {
+	return a.x == 0.0f && a.y == 0.0f;
+}
+
 #pragma mark - 3D Vector
 
 vec3_t vec3_zero(void) {
@@ -115,6 +119,10 @@ vec3_t vec3_interpolate(vec3_t a, vec3_t b, float x) {
 	return vec3_add(a1, b1);
 }
 
+bool vec3_is_zero(vec3_t a) {
+	return a.x == 0.0f && a.y == 0.0f && a.z == 0.0f;
+}
+
 #pragma mark - Products
 
 vec3_t vec3_cross(vec3_t a, vec3_t b) {
@@ -4,6 +4,7 @@
 #define VECTOR_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 // Basic vector types
 
@@ -29,6 +30,7 @@ vec2_t vec2_div(vec2_t a, float b);
 vec2_t vec2_rotate(vec2_t p, float a);
 float vec2_length(vec2_t v);
 float vec2_cross(vec2_t a, vec2_t b);
+bool vec2_is_zero(vec2_t a);
 
 // 3D Functions
 vec3_t vec3_zero(void);
@@ -41,6 +43,7 @@ vec3_t vec3_div(vec3_t a, float b);
 float vec3_length(vec3_t v);
 vec2_t vec3_to_vec2(vec3_t a);
 vec3_t vec3_interpolate(vec3_t a, vec3_t b, float x);
+bool vec3_is_zero(vec3_t a);
 
 vec3_t vec3_cross(vec3_t a, vec3_t b);
 float vec3_dot(vec3_t a, vec3_t b);